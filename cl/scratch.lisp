@@ -26,11 +26,12 @@
   (mapcar #'read-from-string number-string-seq))
 
 (defun get-balance-at-block (address block)
-  (let ((blocks (get-blocks-referencing address)))
-    (loop for blocknum in (sort (to-numbers blocks) #'<)
-          while (< blocknum block)
-          collecting (get-change-at-block address blocknum) into changes
-          finally (return (reduce #'+ (to-numbers changes))))))
+  (with-connection
+      (let ((last (red:zrevrangebyscore (concatenate 'string "znn:balance:" address)
+                                        (format nil "(~A" block) "-inf" :limit '(0 . 1))))
+        (if last
+            (read-from-string (subseq (first last) (1+ (position #\: (first last)))))
+            0))))
 
 (defun get-max-block-height ()
   (with-connection
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blockparser
+{
+    /// Sorted, front coded set of addresses for case insensitive prefix search. Addresses are ordered by their
+    /// lower case form and stored in buckets of `bucket_size`: the first address of a bucket is stored in full,
+    /// the others as the length of the prefix shared with their predecessor and the remaining characters. A query
+    /// is a binary search over the first addresses of the buckets and a scan of one bucket at either end of the
+    /// matching range; the matches themselves are consecutive, so listing them is a sequential decode.
+    class AddressIndex
+    {
+    public:
+        AddressIndex() = default;
+        explicit AddressIndex(std::vector<std::string> addresses);
+
+        /// Number of distinct addresses.
+        size_t size() const { return size_; }
+
+        /// Bytes held by the encoded addresses and the bucket offsets.
+        size_t bytes() const { return data_.size() + heads_.size() * sizeof(uint32_t); }
+
+        /// Number of addresses starting with prefix, ignoring case.
+        size_t count(std::string const& prefix) const;
+
+        /// The first (at most) limit addresses starting with prefix, ignoring case, in order of their lower case
+        /// form.
+        std::vector<std::string> find(std::string const& prefix, size_t limit) const;
+
+    private:
+        static size_t constexpr bucket_size{16};
+
+        std::string data_{};            // per address: shared length, suffix length, suffix
+        std::vector<uint32_t> heads_{}; // offset of each bucket in data_
+        size_t size_{};
+
+        /// Position of the first address whose lower case form, cut to the prefix' length, is not below
+        /// (`upper` false) or above (`upper` true) the lower case prefix.
+        size_t position(std::string const& prefix, bool upper) const;
+
+        /// Decode the address at offset on top of its predecessor; returns the offset of the next one.
+        size_t decode(size_t offset, std::string& address) const;
+    };
+} // namespace blockparser
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace blockparser
+{
+    /// Dense ids for addresses, assigned in order of first appearance.
+    class AddressTable
+    {
+    public:
+        /// The id of address, assigning the next free one if it wasn't seen before; second is true if it was.
+        std::pair<uint32_t, bool> insert(std::string const& address)
+        {
+            auto [it, inserted]{ids_.try_emplace(address, static_cast<uint32_t>(addresses_.size()))};
+            if (inserted)
+            {
+                addresses_.push_back(&it->first);
+            }
+
+            return {it->second, inserted};
+        }
+
+        std::optional<uint32_t> find(std::string const& address) const
+        {
+            auto it{ids_.find(address)};
+            return it == ids_.end() ? std::nullopt : std::make_optional(it->second);
+        }
+
+        std::string const& address(uint32_t id) const { return *addresses_.at(id); }
+
+        size_t size() const { return addresses_.size(); }
+
+    private:
+        std::unordered_map<std::string, uint32_t> ids_{};
+        std::vector<std::string const*> addresses_{}; // keys of ids_, which are stable
+    };
+} // namespace blockparser
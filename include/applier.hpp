@@ -0,0 +1,65 @@
+#pragma once
+
+#include "block.hpp"
+#include "chain_index.hpp"
+#include "sink.hpp"
+
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace blockparser
+{
+    /// Streams the main chain out of the blockfiles in file order and hands the blocks to a callback in height
+    /// order. Blocks stored ahead of their parent are parked in an orphan buffer until their parent has been
+    /// applied. Parked blocks are kept parsed while the buffer is within its budget (in serialized bytes);
+    /// beyond that only their location is kept, and they are read again when they are due.
+    /// Peak memory is bounded by the reordering window of the files, not by the length of the chain.
+    class ChainApplier
+    {
+    public:
+        using apply_t = std::function<void(BlockPtr const& block, ChainEntry const& entry, size_t height)>;
+
+        static size_t constexpr default_budget{256u << 20};
+
+        ChainApplier(ChainIndex const& chain, std::vector<std::string> paths, size_t budget = default_budget)
+            : chain_{chain}, paths_{std::move(paths)}, budget_{budget}
+        {
+        }
+
+        /// Apply all main chain blocks from `from_height` up to the tip. Blocks below are not parsed.
+        void run(size_t from_height, apply_t const& apply);
+
+        /// Apply the main chain blocks following the tip of `utxos` to it, and feed those from
+        /// `sink.next_height()` on to the sink. Flushes the sink at the end.
+        void run(UtxoSet& utxos, Sink& sink);
+
+        size_t peak_buffered_bytes() const { return peak_buffered_; }
+        size_t peak_buffered_blocks() const { return peak_parked_; }
+        size_t spilled() const { return spilled_; }
+
+    private:
+        struct Parked
+        {
+            BlockPtr block{}; // null if spilled
+            BlockLocation location{};
+        };
+
+        ChainIndex const& chain_;
+        std::vector<std::string> const paths_;
+        size_t const budget_;
+
+        std::vector<std::ifstream> streams_{};
+        std::map<size_t, Parked> parked_{};
+        size_t buffered_{};
+
+        size_t peak_buffered_{};
+        size_t peak_parked_{};
+        size_t spilled_{};
+
+        BlockPtr read(BlockLocation const& location, size_t height);
+        void park(size_t height, BlockLocation const& location);
+    };
+} // namespace blockparser
@@ -26,10 +26,6 @@ namespace blockparser
 
         void set_height(size_t height) { height_ = height; }
 
-        void set_follower(uint256 hash) { follower_ = std::move(hash); }
-
-        uint256 const& follower() const { return follower_; }
-
     private:
         std::ifstream::pos_type position_{};
         size_t height_{};
@@ -39,8 +35,6 @@ namespace blockparser
         std::vector<Transaction> transactions_{};
         std::vector<unsigned char> signee_{};
 
-        uint256 follower_{}; // next block hash
-
         friend Block read_block(std::ifstream&, uint32_t, size_t);
     };
 
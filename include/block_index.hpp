@@ -0,0 +1,107 @@
+#pragma once
+
+#include "header.hpp"
+#include "transaction.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace blockparser
+{
+    /// Position of a serialized block within the blockfiles: offset points behind the length field.
+    struct BlockLocation
+    {
+        uint32_t file{};
+        uint64_t offset{};
+        uint32_t size{};
+    };
+
+    struct IndexEntry
+    {
+        uint256 hash{};
+        Header header{};
+        BlockLocation location{};
+        uint32_t tx_count{};
+
+        IndexEntry const* prev{};
+        uint256 chainwork{}; // cumulative work up to and including this block
+        size_t height{};
+
+        bool linked{};     // reachable from genesis
+        bool main_chain{}; // ancestor of (or equal to) the best tip
+    };
+
+    /// Order of storage in the blockfiles; on equal work, the tip stored first wins.
+    inline bool operator<(BlockLocation const& lhs, BlockLocation const& rhs)
+    {
+        return lhs.file < rhs.file || (lhs.file == rhs.file && lhs.offset < rhs.offset);
+    }
+
+    /// Size and modification time of a blockfile, to detect whether persisted index entries are stale.
+    struct FileStamp
+    {
+        uint64_t size{};
+        int64_t mtime{};
+    };
+
+    inline bool operator==(FileStamp const& lhs, FileStamp const& rhs)
+    {
+        return lhs.size == rhs.size && lhs.mtime == rhs.mtime;
+    }
+
+    FileStamp file_stamp(std::string const& path);
+
+    /// Work represented by a block with the given compact target: 2^256 / (target + 1) (main.cpp:GetBlockProof).
+    uint256 block_work(uint32_t bits);
+
+    /// Index over all block headers found in the blockfiles, independent of their order on disk.
+    /// After all headers are added, select_best_chain links them and determines the tip with the most
+    /// cumulative work.
+    class BlockIndex
+    {
+    public:
+        using map_t = std::unordered_map<uint256, IndexEntry, detail::uint256_cheap_hash>;
+
+        /// Add a header; duplicates (a block stored twice) are ignored. Returns false for those.
+        bool add(uint256 const& hash, Header const& header, BlockLocation location, uint32_t tx_count);
+
+        /// Link all headers to their predecessors, assign heights and chainwork in a single traversal
+        /// from genesis, and select the tip with the most work. Headers not connected to genesis stay unlinked.
+        void select_best_chain();
+
+        IndexEntry const* find(uint256 const& hash) const
+        {
+            auto it{entries_.find(hash)};
+            return it == entries_.end() ? nullptr : &it->second;
+        }
+
+        /// The tip with the most work; nullptr before select_best_chain or without genesis.
+        IndexEntry const* tip() const { return tips_.empty() ? nullptr : tips_.front(); }
+
+        /// All linked chain tips (blocks without successor), ordered by descending chainwork.
+        std::vector<IndexEntry const*> const& tips() const { return tips_; }
+
+        /// Entries of the best chain, ordered by height.
+        std::vector<IndexEntry const*> main_chain() const;
+
+        map_t const& entries() const { return entries_; }
+        size_t size() const { return entries_.size(); }
+
+        /// Number of headers whose ancestry does not lead to genesis.
+        size_t unlinked() const { return unlinked_; }
+
+        /// Persist all entries, sorted by hash, together with the stamps of the files they were read from.
+        void save(std::string const& path, std::vector<FileStamp> const& stamps) const;
+
+        /// Add the entries of a persisted index for every file whose stamp still matches. Returns, per file,
+        /// whether its entries were restored; files that changed or are new have to be scanned again.
+        /// Restored headers only carry the fields the index needs (version, previous hash, time, bits).
+        std::vector<bool> load(std::string const& path, std::vector<FileStamp> const& stamps);
+
+    private:
+        map_t entries_{};
+        std::vector<IndexEntry const*> tips_{};
+        size_t unlinked_{};
+    };
+} // namespace blockparser
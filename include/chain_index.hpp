@@ -0,0 +1,55 @@
+#pragma once
+
+#include "block_index.hpp"
+
+#include <vector>
+
+namespace blockparser
+{
+    struct ChainEntry
+    {
+        uint256 hash{};
+        BlockLocation location{};
+        uint32_t time{};
+        uint32_t tx_count{};
+    };
+
+    /// The main chain as a contiguous vector indexed by height.
+    class ChainIndex
+    {
+    public:
+        ChainIndex() = default;
+
+        explicit ChainIndex(BlockIndex const& index)
+        {
+            auto const chain{index.main_chain()};
+            entries_.reserve(chain.size());
+
+            for (auto const* entry : chain)
+            {
+                entries_.push_back({entry->hash, entry->location, entry->header.time_, entry->tx_count});
+            }
+        }
+
+        ChainEntry const& operator[](size_t height) const { return entries_[height]; }
+        ChainEntry const& at(size_t height) const { return entries_.at(height); }
+
+        /// True if hash is the main chain block at height.
+        bool contains(uint256 const& hash, size_t height) const
+        {
+            return height < entries_.size() && entries_[height].hash == hash;
+        }
+
+        size_t size() const { return entries_.size(); }
+        bool empty() const { return entries_.empty(); }
+
+        ChainEntry const& genesis() const { return entries_.front(); }
+        ChainEntry const& tip() const { return entries_.back(); }
+
+        auto begin() const { return entries_.begin(); }
+        auto end() const { return entries_.end(); }
+
+    private:
+        std::vector<ChainEntry> entries_{};
+    };
+} // namespace blockparser
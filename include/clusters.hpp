@@ -0,0 +1,75 @@
+#pragma once
+
+#include "address_table.hpp"
+#include "sink.hpp"
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace blockparser
+{
+    /// Clusters addresses by common input ownership, as a Sink: the addresses of the outputs claimed by the inputs
+    /// of one transaction are taken to belong to one owner. The edges between co-spent addresses of the blocks up
+    /// to `height` are collected while the chain is read, and united on `threads` threads in a lock-free
+    /// union-find over dense address ids when the sink is flushed. Every address with a balance entry at
+    /// `height` is in exactly one cluster.
+    class ClusterSink : public Sink
+    {
+    public:
+        struct Options
+        {
+            size_t height{SIZE_MAX}; // default the tip
+            size_t threads{4};
+        };
+
+        struct Cluster
+        {
+            uint32_t id{}; // the smallest address id in the cluster, i.e. its first seen address
+            uint32_t size{};
+            int64_t balance{}; // at height
+        };
+
+        explicit ClusterSink(Options options) : options_{std::move(options)} {}
+
+        void begin_block(Block const& block, uint256 const& hash, size_t height) override;
+        void put_output(OutPoint const&, Coin const&) override {}
+        void spend(OutPoint const& outpoint, Coin const& coin) override;
+        void end_block(UtxoSet const& utxos) override;
+
+        /// Unite the collected edges and build the clusters.
+        void flush() override;
+
+        /// Clusters by balance, then size (descending); complete after `flush`.
+        std::vector<Cluster> const& clusters() const { return clusters_; }
+
+        /// The cluster id of each address id.
+        std::vector<uint32_t> const& cluster_ids() const { return cluster_ids_; }
+
+        AddressTable const& addresses() const { return addresses_; }
+
+        /// The height the balances are taken at.
+        std::optional<size_t> height() const { return balance_height_; }
+
+    private:
+        Options const options_;
+
+        AddressTable addresses_{};
+        std::vector<std::pair<uint32_t, uint32_t>> edges_{};
+        std::vector<int64_t> balances_{}; // by address id
+        std::optional<size_t> balance_height_{};
+
+        std::vector<Cluster> clusters_{};
+        std::vector<uint32_t> cluster_ids_{};
+
+        // the block being fed
+        std::vector<size_t> claiming_{}; // the tx (in the block) of each input that claims an output, in order
+        std::vector<std::optional<uint32_t>> first_{}; // address id of the first addressed input, per tx
+        size_t claimed_{};
+        size_t height_{};
+        UtxoSet const* utxos_{}; // as of the last block up to height
+
+        void take_balances(UtxoSet const& utxos);
+    };
+} // namespace blockparser
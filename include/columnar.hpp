@@ -0,0 +1,77 @@
+#pragma once
+
+#include "sink.hpp"
+
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace blockparser
+{
+    /// Writes the main chain as columnar tables for analytics, one file per table in `directory`:
+    /// - `blocks`: height, hash, previous, merkle_root, version, time, bits, nonce, size, txs
+    /// - `txs`: height, position (in the block), txid, version, locktime, size, inputs, outputs
+    /// - `vin`: height, txid, index, prev_txid, prev_index, sequence, address, amount (of the claimed output;
+    ///   prev_txid, prev_index, address and amount are null for inputs that claim no output)
+    /// - `vout`: height, txid, index, address (null if none), amount, script_type
+    /// as Parquet (`<table>.parquet`) or Arrow IPC files (`<table>.arrow`). Hashes are hex strings, as printed
+    /// by the node. Every `row_group_blocks` blocks form a row group (a record batch in IPC files) of each
+    /// table; row groups are built on up to `threads` threads while the chain is read, and written in order.
+    /// Only available if built with Arrow (WITH_ARROW); the constructor throws a ColumnarException otherwise.
+    class ColumnarSink : public Sink
+    {
+    public:
+        enum class Format
+        {
+            parquet,
+            ipc
+        };
+
+        struct Options
+        {
+            std::string directory{"."};
+            Format format{Format::parquet};
+            size_t row_group_blocks{10000};
+            size_t threads{4};
+        };
+
+        explicit ColumnarSink(Options options);
+        ~ColumnarSink() override;
+
+        void begin_block(Block const& block, uint256 const& hash, size_t height) override;
+        void put_output(OutPoint const&, Coin const&) override {}
+        void spend(OutPoint const& outpoint, Coin const& coin) override;
+        void end_block(UtxoSet const& utxos) override;
+
+        /// Write the remaining blocks and close the files.
+        void flush() override;
+
+        /// Rows written to all tables.
+        size_t rows() const { return rows_; }
+
+    private:
+        struct Item
+        {
+            Block block;
+            uint256 hash{};
+            size_t height{};
+            std::vector<std::pair<OutPoint, Coin>> spent{}; // in input order
+        };
+
+        struct RowGroup; // one record batch per table
+        struct Writers;
+
+        Options const options_;
+        std::unique_ptr<Writers> writers_;
+
+        std::vector<Item> items_{}; // blocks of the row group being collected
+        std::deque<std::future<std::shared_ptr<RowGroup>>> building_{}; // in block order
+        size_t rows_{};
+
+        static std::shared_ptr<RowGroup> build(std::vector<Item> items);
+        void submit();
+        void write_front();
+    };
+} // namespace blockparser
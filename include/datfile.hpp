@@ -1,12 +1,15 @@
 #pragma once
 
 #include "block.hpp"
+#include "block_index.hpp"
 #include "util.hpp"
 
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <optional>
+#include <unistd.h>
 #include <unordered_map>
 #include <vector>
 
@@ -17,10 +20,6 @@ namespace blockparser
     public:
         BlockVec const& blocks() const { return blocks_; }
 
-        BlockMap const& blockhashtable() const { return hashmap_; }
-
-        TxMap const& tx2blockhashmap() const { return tx2blockmap_; }
-
         explicit Datfile(std::string filepath) : filepath_{std::move(filepath)}
         {
             std::cout << "Reading blocks from " << filepath_ << std::endl;
@@ -84,17 +83,92 @@ namespace blockparser
 
         explicit operator bool() const { return parse_ok_; }
 
+        /// Locate all blocks in a file without parsing them. Offsets point behind the length field.
+        static std::vector<BlockLocation> locate(std::string const& filepath, uint32_t file_number)
+        {
+            std::ifstream file{filepath, std::ios::in | std::ios::binary};
+            assert(file.good());
+
+            auto const block_limits{locate_blocks(file)};
+            _assert_block_limits_valid(file, block_limits);
+
+            file.seekg(0, file.end);
+            auto const file_size{static_cast<uint64_t>(file.tellg())};
+
+            std::vector<BlockLocation> locations;
+            for (auto&& limits : block_limits)
+            {
+                file.seekg(limits.first);
+
+                uint32_t block_length{};
+                util::read(file, block_length);
+
+                auto const offset{static_cast<uint64_t>(file.tellg())};
+                if (offset + block_length > file_size)
+                {
+                    std::cout << "Truncated block at " << offset << " in " << filepath << std::endl;
+                    break;
+                }
+
+                locations.push_back({file_number, offset, block_length});
+            }
+
+            return locations;
+        }
+
+        /// Read the serialized block at a known location, without framing the file.
+        static std::vector<uint8_t> read_raw(std::string const& filepath, BlockLocation const& location)
+        {
+            std::vector<uint8_t> bytes(location.size);
+
+            auto const fd{::open(filepath.c_str(), O_RDONLY)};
+            if (fd < 0)
+            {
+                throw ParseException{"Can't open " + filepath};
+            }
+
+            auto const read{::pread(fd, bytes.data(), bytes.size(), static_cast<off_t>(location.offset))};
+            ::close(fd);
+
+            if (read != static_cast<ssize_t>(bytes.size()))
+            {
+                throw ParseException{"Short read of " + std::to_string(location.size) + " bytes at " +
+                                     std::to_string(location.offset) + " in " + filepath};
+            }
+
+            return bytes;
+        }
+
+        /// Add the header of every block in a file to the index, without parsing the transactions.
+        /// Returns the number of blocks found.
+        static size_t index_headers(std::string const& filepath, uint32_t file_number, BlockIndex& index)
+        {
+            std::cout << "Reading headers from " << filepath << std::endl;
+
+            auto const locations{locate(filepath, file_number)};
+            std::ifstream file{filepath, std::ios::in | std::ios::binary};
+
+            for (auto&& location : locations)
+            {
+                file.seekg(location.offset);
+
+                auto const header{read_header(file)};
+                auto const tx_count{util::read_vectorsize(file)};
+
+                index.add(hash(header), header, location, static_cast<uint32_t>(tx_count));
+            }
+
+            return locations.size();
+        }
+
     private:
         std::string const filepath_;
         BlockVec blocks_;
-        BlockMap hashmap_;
-        BlockLinks block_links_;
-        TxMap tx2blockmap_;
 
         bool parse_ok_{true};
 
-        std::vector<std::pair<std::ifstream::pos_type, std::ifstream::pos_type>> locate_blocks(
-            std::ifstream& file) const
+        static std::vector<std::pair<std::ifstream::pos_type, std::ifstream::pos_type>> locate_blocks(
+            std::ifstream& file)
         {
             std::vector<std::pair<std::ifstream::pos_type, std::ifstream::pos_type>> block_limits;
 
@@ -114,7 +188,7 @@ namespace blockparser
             return block_limits;
         }
 
-        std::pair<std::ifstream::pos_type, std::ifstream::pos_type> locate_next_block(std::ifstream& file) const
+        static std::pair<std::ifstream::pos_type, std::ifstream::pos_type> locate_next_block(std::ifstream& file)
         {
             static auto constexpr block_start_size{sizeof(block_start_pattern)};
 
@@ -138,7 +212,7 @@ namespace blockparser
             return std::make_pair(begin + static_cast<std::ifstream::pos_type>(block_start_size), end);
         }
 
-        void _assert_block_limits_valid(
+        static void _assert_block_limits_valid(
             std::ifstream& file,
             std::vector<std::pair<std::ifstream::pos_type, std::ifstream::pos_type>> const& block_limits)
         {
@@ -185,7 +259,7 @@ namespace blockparser
         // Locate the next position of the block start pattern.
         // If no block start pattern is found, eof is returned.
         // The stream is positioned in front of the found pattern, or at eof.
-        std::ifstream::pos_type _locate_block_start_pattern(std::ifstream& file) const
+        static std::ifstream::pos_type _locate_block_start_pattern(std::ifstream& file)
         {
             static auto constexpr block_start_size{sizeof(block_start_pattern)};
             uint8_t block_start_buffer[block_start_size];
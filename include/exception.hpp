@@ -50,4 +50,54 @@ namespace blockparser
         explicit RedisException(std::string error) : exception{"RedisException: " + error} {}
     };
 
+    struct UtxoException : public exception
+    {
+        explicit UtxoException(std::string error) : exception{"UtxoException: " + error} {}
+    };
+
+    struct SnapshotException : public exception
+    {
+        explicit SnapshotException(std::string error) : exception{"SnapshotException: " + error} {}
+    };
+
+    struct LogStoreException : public exception
+    {
+        explicit LogStoreException(std::string error) : exception{"LogStoreException: " + error} {}
+    };
+
+    struct ColumnarException : public exception
+    {
+        explicit ColumnarException(std::string error) : exception{"ColumnarException: " + error} {}
+    };
+
+    struct ServerException : public exception
+    {
+        explicit ServerException(std::string error) : exception{"ServerException: " + error} {}
+    };
+
+    struct SupplyException : public exception
+    {
+        explicit SupplyException(std::string error) : exception{"SupplyException: " + error} {}
+    };
+
+    struct ArgumentException : public exception
+    {
+        explicit ArgumentException(std::string error) : exception{"ArgumentException: " + error} {}
+    };
+
+    struct HistogramException : public exception
+    {
+        explicit HistogramException(std::string error) : exception{"HistogramException: " + error} {}
+    };
+
+    struct FlowException : public exception
+    {
+        explicit FlowException(std::string error) : exception{"FlowException: " + error} {}
+    };
+
+    struct RdbException : public exception
+    {
+        explicit RdbException(std::string error) : exception{"RdbException: " + error} {}
+    };
+
 } // namespace blockparser
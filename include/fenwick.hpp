@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace blockparser
+{
+    /// Fenwick (binary indexed) tree of sums over the indexes 0, 1, ...: point updates and prefix sums in
+    /// O(log n). The tree grows on demand by doubling; with a power of two size the only new node that covers
+    /// old indexes is the last one, which covers all of them, so growing is O(log n) as well.
+    template <typename T>
+    class FenwickTree
+    {
+    public:
+        /// Add value at index.
+        void add(size_t index, T value)
+        {
+            grow(index + 1);
+            for (auto i{index + 1}; i < tree_.size(); i += i & (~i + 1))
+            {
+                tree_[i] += value;
+            }
+        }
+
+        /// The sum over [0, end).
+        T prefix(size_t end) const
+        {
+            T sum{};
+            for (auto i{std::min(end, tree_.size() - 1)}; i > 0; i -= i & (~i + 1))
+            {
+                sum += tree_[i];
+            }
+            return sum;
+        }
+
+        /// The sum over [begin, end).
+        T range(size_t begin, size_t end) const { return begin < end ? prefix(end) - prefix(begin) : T{}; }
+
+    private:
+        // 1-based, tree_[i] sums (i - lowbit(i), i]; the size is a power of two plus one
+        std::vector<T> tree_{std::vector<T>(1)};
+
+        void grow(size_t size)
+        {
+            while (tree_.size() - 1 < size)
+            {
+                auto const old{tree_.size() - 1};
+                auto const total{prefix(old)};
+                tree_.resize(old == 0 ? 2 : 2 * old + 1);
+                tree_.back() = total;
+            }
+        }
+    };
+} // namespace blockparser
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "sink.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace blockparser
+{
+    /// Layout of the binary flow table (little endian): FlowHeader, then one FlowRecord per height from 0.
+    namespace flow
+    {
+        static char constexpr magic[8]{'Z', 'N', 'N', 'F', 'L', 'O', 'W', '\0'};
+        static uint32_t constexpr version{1};
+
+        struct FlowHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t record_size;
+        };
+
+        struct FlowRecord
+        {
+            double cdd;          // coin-days destroyed: the spent coins times their age in days, by block time
+            int64_t spent;       // the amount of the spent outputs
+            int64_t volume;      // paid by the regular txs to addresses that aren't among their inputs
+            int64_t unspent;     // the amount of the unspent outputs after the block
+            uint32_t time;       // of the block
+            uint32_t txs;        // in the block
+            uint32_t inputs;     // that claim an output
+            uint32_t outputs;    // created
+            uint32_t mean_age;   // of the spent outputs, in blocks
+            uint32_t median_age; // of the spent outputs, in blocks
+            uint32_t max_age;    // of the spent outputs, in blocks
+            uint32_t padding;
+        };
+
+        static_assert(sizeof(FlowHeader) == 16);
+        static_assert(sizeof(FlowRecord) == 64);
+    } // namespace flow
+
+    /// Streams per block coin flow metrics to a file, as a Sink fed from genesis: coin-days destroyed, the ages of
+    /// the spent outputs (as known from the heights of their coins), the tx, input and output counts and the
+    /// transferred volume. Change is excluded from the volume heuristically, as the outputs of a tx to addresses
+    /// among its inputs; the outputs of coinbases and coinstakes aren't volume at all. The unspent amount makes
+    /// volume / unspent the velocity of a block.
+    class FlowSink : public Sink
+    {
+    public:
+        enum class Format
+        {
+            binary, // the flow table
+            csv     // height,time,txs,inputs,outputs,spent,volume,unspent,velocity,cdd,mean_age,median_age,max_age
+        };
+
+        FlowSink(std::string const& path, Format format);
+
+        void begin_block(Block const& block, uint256 const& hash, size_t height) override;
+        void put_output(OutPoint const& outpoint, Coin const& coin) override;
+        void spend(OutPoint const& outpoint, Coin const& coin) override;
+        void end_block(UtxoSet const& utxos) override;
+        void flush() override;
+
+        /// Over all blocks fed.
+        double cdd() const { return cdd_; }
+        int64_t volume() const { return volume_; }
+
+    private:
+        struct Pending
+        {
+            bool minting{};
+            std::vector<TxOutput const*> outputs{};
+            std::vector<std::string> senders{}; // the addresses of the claimed outputs
+        };
+
+        std::string const path_;
+        Format const format_;
+        std::ofstream file_;
+
+        std::vector<uint32_t> times_{}; // of the blocks, by height
+        int64_t unspent_{};
+        double cdd_{};
+        int64_t volume_{};
+
+        // the block being fed
+        flow::FlowRecord record_{};
+        size_t height_{};
+        std::vector<Pending> pending_{};
+        std::vector<size_t> claiming_{}; // the pending tx of each input that claims an output, in order
+        size_t claimed_{};
+        std::vector<uint32_t> ages_{};
+    };
+} // namespace blockparser
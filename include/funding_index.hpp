@@ -0,0 +1,85 @@
+#pragma once
+
+#include "address_table.hpp"
+#include "sink.hpp"
+
+#include <string>
+#include <vector>
+
+namespace blockparser
+{
+    /// Reverse funding index, filled as a Sink in one pass over the main chain: for every address the
+    /// transactions that paid to it, and for every such transaction the addresses of the outputs its inputs
+    /// claimed. Outputs to an address that is also among the inputs of the transaction are change and don't
+    /// count as funding; coinbase and coinstake payouts have no senders.
+    class FundingIndex : public Sink
+    {
+    public:
+        struct Sender
+        {
+            std::string address{};
+            int64_t amount{}; // attributed to the sender, see `senders`
+            uint32_t txs{};   // funding transactions the sender had inputs in
+        };
+
+        struct Funding
+        {
+            uint256 txid{};
+            uint32_t height{};
+            int64_t amount{}; // received by the address
+        };
+
+        void begin_block(Block const& block, uint256 const& hash, size_t height) override;
+        void put_output(OutPoint const&, Coin const&) override {}
+        void spend(OutPoint const& outpoint, Coin const& coin) override;
+        void end_block(UtxoSet const& utxos) override;
+        void flush() override {}
+
+        /// The transactions that funded an address, in chain order.
+        std::vector<Funding> fundings(std::string const& address) const;
+
+        /// The distinct senders to any of addresses, by amount (descending). What the addresses received in a
+        /// transaction is attributed to its senders in proportion to the amounts of their inputs.
+        std::vector<Sender> senders(std::vector<std::string> const& addresses) const;
+
+        size_t funding_txs() const { return txids_.size(); }
+
+    private:
+        struct Received
+        {
+            uint32_t tx{}; // funding tx id
+            int64_t amount{};
+        };
+
+        struct Input
+        {
+            uint32_t address{};
+            int64_t amount{};
+        };
+
+        AddressTable addresses_{};
+        std::vector<std::vector<Received>> received_{}; // by recipient address id
+
+        // by funding tx id; the senders of tx i are inputs_[input_offsets_[i]] up to inputs_[input_offsets_[i + 1]]
+        std::vector<uint256> txids_{};
+        std::vector<uint32_t> heights_{};
+        std::vector<uint64_t> input_offsets_{0};
+        std::vector<Input> inputs_{};
+
+        // the block being fed
+        struct Pending
+        {
+            uint256 txid{};
+            bool minting{}; // coinbases and coinstakes, whose payouts have no senders
+            std::vector<Input> outputs{};
+            std::vector<Input> inputs{};
+        };
+
+        std::vector<Pending> pending_{};
+        std::vector<size_t> claiming_{}; // the pending tx of each input that claims an output, in order
+        size_t claimed_{};
+        uint32_t height_{};
+
+        uint32_t id(std::string const& address);
+    };
+} // namespace blockparser
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "sink.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace blockparser
+{
+    /// On-disk layout of the chain log, a single append-only file (little endian, fixed size records):
+    ///   LogHeader
+    ///   LogRecord[...]  per block: its outputs, spends and balance changes, then the block record
+    /// A block record closes its block and carries a checksum over the records since the previous block record,
+    /// so a block whose writing was interrupted is detected and dropped when the log is opened again.
+    namespace logstore
+    {
+        static char constexpr magic[8]{'Z', 'N', 'N', 'C', 'L', 'O', 'G', '\0'};
+        static uint32_t constexpr version{1};
+        static size_t constexpr address_size{34};
+        static uint64_t constexpr no_record{UINT64_MAX};
+
+        enum RecordType : uint8_t
+        {
+            output  = 1, // an output created at height
+            spend   = 2, // an output claimed at height, with the amount and address of the spent coin
+            balance = 3, // balance of address after the block at height; link is its previous balance record
+            block   = 4, // hash of the block at height, index its number of txs; link is the checksum
+        };
+
+        struct LogHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t record_size;
+        };
+
+        struct LogRecord
+        {
+            uint8_t type;
+            uint8_t reserved[3];
+            uint32_t height;
+            uint8_t hash[32]; // tx hash of the outpoint, block hash for block records
+            uint32_t index;
+            uint32_t reserved2;
+            int64_t amount;
+            uint64_t link;
+            char address[address_size]; // zero padded
+            char padding[6];
+        };
+
+        static_assert(sizeof(LogHeader) == 16);
+        static_assert(sizeof(LogRecord) == 104);
+
+        inline std::string address(char const (&field)[address_size])
+        {
+            return std::string{field, strnlen(field, address_size)};
+        }
+    } // namespace logstore
+
+    /// Read-only, memory mapped view of a chain log, with hash indexes over its records that are built when
+    /// opening. Records after the last complete block are ignored. Throws a LogStoreException if the file is
+    /// not a chain log.
+    class MappedLog
+    {
+    public:
+        using address_map_t = std::unordered_map<std::string, uint64_t>;
+
+        explicit MappedLog(std::string const& path);
+        ~MappedLog();
+
+        MappedLog(MappedLog const&) = delete;
+        MappedLog& operator=(MappedLog const&) = delete;
+
+        /// Height of the block following the last complete one.
+        size_t next_height() const { return blocks_.size(); }
+
+        /// Hash of the last complete block; null if there is none.
+        uint256 tip() const;
+
+        /// Number of records up to the last complete block.
+        uint64_t records() const { return records_; }
+        logstore::LogRecord const& record(uint64_t i) const { return records_begin_[i]; }
+
+        /// The record that created, or that spent an output; null if there is none.
+        logstore::LogRecord const* output(OutPoint const& outpoint) const;
+        logstore::LogRecord const* spend(OutPoint const& outpoint) const;
+
+        /// Balance of an address after the block at height; empty if it had no transaction up to there.
+        std::optional<int64_t> balance(std::string const& address, size_t height) const;
+
+        /// The last balance record of each address.
+        address_map_t const& addresses() const { return addresses_; }
+
+    private:
+        struct OutputRecords
+        {
+            uint64_t created{logstore::no_record};
+            uint64_t spent{logstore::no_record};
+        };
+
+        void* data_{};
+        size_t size_{};
+
+        logstore::LogRecord const* records_begin_{};
+        uint64_t records_{};
+
+        std::vector<uint64_t> blocks_{}; // by height
+        std::unordered_map<OutPoint, OutputRecords, detail::outpoint_hash> outputs_{};
+        address_map_t addresses_{};
+
+        void index(uint64_t first, uint64_t last);
+    };
+
+    /// Appends the chain to a chain log: an embedded store that needs no server, and is queried through
+    /// MappedLog. An existing log is continued after its last complete block; a partially written block is
+    /// truncated first.
+    class LogSink : public Sink
+    {
+    public:
+        explicit LogSink(std::string path);
+
+        size_t next_height() const override { return next_height_; }
+
+        /// Hash of the last stored block; null if there is none.
+        uint256 const& tip() const { return tip_; }
+
+        void begin_block(Block const& block, uint256 const& hash, size_t height) override;
+        void put_output(OutPoint const& outpoint, Coin const& coin) override;
+        void spend(OutPoint const& outpoint, Coin const& coin) override;
+        void end_block(UtxoSet const& utxos) override;
+
+        void flush() override;
+
+        uint64_t records() const { return records_; }
+
+    private:
+        std::string const path_;
+        std::ofstream file_{};
+
+        uint64_t records_{};
+        size_t next_height_{};
+        uint256 tip_{};
+        MappedLog::address_map_t last_balance_{};
+
+        // the block being fed
+        logstore::LogRecord block_record_{};
+        std::vector<logstore::LogRecord> pending_{};
+        std::set<std::string> touched_{}; // addresses whose balance changed
+    };
+} // namespace blockparser
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "address_index.hpp"
+#include "sink.hpp"
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace blockparser
+{
+    /// In-memory indexes over the main chain for the queries of `serve`, filled as a Sink. The index is read
+    /// only once the chain has been fed, so any number of threads may query it concurrently.
+    class QueryIndex : public Sink
+    {
+    public:
+        struct BlockInfo
+        {
+            uint256 hash{};
+            uint256 merkle_root{};
+            uint32_t time{};
+            std::vector<uint256> txids{};
+        };
+
+        /// An input with the output it claims; inputs that claim no output (coinbase) are not listed.
+        struct Input
+        {
+            OutPoint outpoint{};
+            Coin coin{};
+        };
+
+        struct TxInfo
+        {
+            uint32_t height{};
+            uint32_t outputs{};
+            std::vector<Input> inputs{};
+        };
+
+        struct Spender
+        {
+            uint256 txid{};
+            uint32_t height{};
+        };
+
+        struct BalanceChange
+        {
+            uint32_t height{};
+            int64_t balance{}; // after the block
+        };
+
+        void begin_block(Block const& block, uint256 const& hash, size_t height) override;
+        void put_output(OutPoint const& outpoint, Coin const& coin) override;
+        void spend(OutPoint const& outpoint, Coin const& coin) override;
+        void end_block(UtxoSet const& utxos) override;
+
+        /// Index the unspent outputs of the UTXO set at the tip by address, and all addresses for prefix search.
+        void flush() override;
+
+        size_t blocks() const { return blocks_.size(); }
+        BlockInfo const* block(size_t height) const { return height < blocks_.size() ? &blocks_[height] : nullptr; }
+        TxInfo const* tx(uint256 const& txid) const;
+
+        /// The tx that claimed an output; empty if it is unspent (or unknown).
+        std::optional<Spender> spender(OutPoint const& outpoint) const;
+
+        /// The txs that claimed outputs of an address, in chain order.
+        std::vector<uint256> const& spending_txs(std::string const& address) const;
+
+        /// Balance of an address after the block at height; empty if it had no transaction up to there.
+        std::optional<int64_t> balance(std::string const& address, size_t height) const;
+
+        /// Unspent outputs of an address at the tip, oldest first.
+        std::vector<std::pair<OutPoint, Coin>> const& unspent(std::string const& address) const;
+
+        /// All addresses that ever received an output.
+        AddressIndex const& addresses() const { return addresses_; }
+
+    private:
+        std::vector<BlockInfo> blocks_{};
+        std::unordered_map<uint256, TxInfo, detail::uint256_cheap_hash> txs_{};
+        std::unordered_map<OutPoint, Spender, detail::outpoint_hash> spenders_{};
+        std::unordered_map<std::string, std::vector<uint256>> spending_txs_{};
+        std::unordered_map<std::string, std::vector<BalanceChange>> history_{};
+        std::unordered_map<std::string, std::vector<std::pair<OutPoint, Coin>>> unspent_{};
+        AddressIndex addresses_{};
+
+        // the block being fed
+        std::vector<uint256> claiming_txs_{}; // the tx of each input that claims an output, in order
+        size_t claimed_{};
+        std::vector<std::string> touched_{};
+        UtxoSet const* utxos_{}; // as of the last block
+    };
+} // namespace blockparser
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "redis_commands.hpp"
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace redis
+{
+    /// CRC-64/Jones as used by redis for RDB checksums (reflected, no final xor).
+    uint64_t crc64(uint64_t crc, unsigned char const* data, size_t size);
+
+    /// Writes a redis RDB file (version 9, database 0) without a running redis-server. Version 9 is the format
+    /// of redis 5.0 to 6.2 (as laid out in their rdb.h), which later versions still load; the files have not been
+    /// checked with redis-check-rdb or loaded into a server of any particular version.
+    /// Strings are written as they come. Sets, hashes, sorted sets and strings written in ranges are usually
+    /// extended over many blocks; they are collected in memory and written on `close`. Sets of at most
+    /// `max_intset_entries` integers are written intset encoded, matching redis' `set-max-intset-entries`
+    /// default; redis picks the encoding of hashes and sorted sets itself when loading. The file is written next
+    /// to `path` and renamed over it once complete.
+    /// Redis refuses a dump that holds a key twice, so a key must be written only once: `close` throws an
+    /// RdbException if it was (e.g. by two SETs), comparing 16 byte digests of the keys, and leaves `path` as it was.
+    class RdbWriter
+    {
+    public:
+        static size_t constexpr max_intset_entries{512};
+
+        explicit RdbWriter(std::string path);
+
+        RdbWriter(RdbWriter const&) = delete;
+        RdbWriter& operator=(RdbWriter const&) = delete;
+
+        /// Apply a SET, SADD, HSET, ZADD, APPEND or SETRANGE command to the keyspace. Other commands throw an
+        /// RdbException. A key must be SET only once and not also be written by another command.
+        void apply(command_t const& command);
+
+        /// Write the collected sets, hashes, sorted sets and ranged strings, the trailer and the checksum; throws
+        /// an RdbException if a key was written twice.
+        void close();
+
+        size_t keys() const { return keys_; }
+
+    private:
+        std::string const path_;
+        std::string const tmp_path_;
+        std::ofstream file_{};
+        uint64_t crc_{};
+        size_t keys_{};
+        std::vector<std::array<unsigned char, 16>> digests_{}; // of the keys written
+
+        std::unordered_map<std::string, std::vector<std::string>> sets_{};
+        std::unordered_map<std::string, std::unordered_map<std::string, std::string>> hashes_{};
+        std::unordered_map<std::string, std::unordered_map<std::string, double>> zsets_{}; // member to score
+        std::unordered_map<std::string, std::string> ranged_{};
+
+        void put(void const* data, size_t size);
+        void put_byte(uint8_t byte) { put(&byte, 1); }
+        void put_length(uint64_t length);
+        void put_string(std::string const& value);
+        void put_key(uint8_t type, std::string const& key);
+
+        void write_string(std::string const& key, std::string const& value);
+        void write_set(std::string const& key, std::vector<std::string>& members);
+        void write_hash(std::string const& key, std::unordered_map<std::string, std::string> const& fields);
+        void write_zset(std::string const& key, std::unordered_map<std::string, double> const& members);
+    };
+} // namespace redis
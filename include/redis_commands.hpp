@@ -0,0 +1,43 @@
+#pragma once
+
+#include "block.hpp"
+#include "utxo.hpp"
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace redis
+{
+    using command_t = std::vector<std::string>;
+
+    /// The commands that store a block in the `znn:` key schema (see README, Data extraction), in the order
+    /// they are sent. Balances of spent outputs come from the block's UTXO delta instead of GETs on the
+    /// previously stored outputs, so the commands for many blocks can be generated without waiting for replies.
+    /// Strings are set only once; the per block marker is `top_command`, sent after the block.
+    /// `utxos` is the UTXO set after the block, for the cumulative balances in `znn:balance:<address>`.
+    std::vector<command_t> block_commands(blockparser::Block const& block, uint256 const& hash,
+                                          blockparser::BlockDelta const& delta, blockparser::UtxoSet const& utxos);
+
+    /// Store the max known blockheight under znn:blocks:top.
+    command_t top_command(size_t height);
+
+    /// A key schema: the commands that store a block, and the command that marks a height as stored.
+    /// The commands of both schemas are idempotent, so a block can be stored again after an interruption.
+    struct Schema
+    {
+        std::string name;
+        std::function<std::vector<command_t>(blockparser::Block const& block, uint256 const& hash,
+                                             blockparser::BlockDelta const& delta,
+                                             blockparser::UtxoSet const& utxos)>
+            block;
+        std::function<command_t(size_t height)> top;
+    };
+
+    /// "classic" for the schema above, "compact" for redis::CompactSchema. Throws a RedisException otherwise.
+    Schema make_schema(std::string const& name);
+
+    /// Serialize a command in the RESP protocol, as read by `redis-cli --pipe`.
+    void write_resp(std::ostream& os, command_t const& command);
+} // namespace redis
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "address_table.hpp"
+#include "redis_commands.hpp"
+
+namespace redis
+{
+    /// A memory compact key schema. Instead of a key per output and per address change, values are packed
+    /// into binary strings and grouped into hashes:
+    /// - `znn:c:top` the height of the last stored block.
+    /// - `znn:c:blk:<height / 128>` hash; field `<height % 128>` is the binary block hash followed by the
+    ///   binary hashes of its transactions.
+    /// - `znn:c:out:<first 2 bytes of the binary txid>` hash; field is the remaining 30 bytes of the txid,
+    ///   value the outputs of that tx with an address, as 16 byte records (index u32, address id u32, amount i64).
+    /// - `znn:c:addr:<id / 128>` hash; field `<id % 128>` is the address with that id.
+    /// - `znn:c:ids` hash of address to id.
+    /// - `znn:c:hist:<id>` the balance changes of an address, one 12 byte record (height u32, change i64)
+    ///   per block. Records are written with SETRANGE at their offset, so storing a block again is harmless.
+    /// Binary hashes are in the byte order of their hex representation; all integers are little endian.
+    /// Not all of these hashes stay listpack encoded; a hash is converted once it has more fields than
+    /// `hash-max-listpack-entries` or any value longer than `hash-max-listpack-value`:
+    /// - `addr` buckets have 128 fields of at most 35 bytes and fit the defaults (128 entries, 64 bytes).
+    /// - `blk` buckets have 128 fields of 32 + 32 * txcount bytes; with `hash-max-listpack-value 1024` those
+    ///   whose blocks all have at most 31 transactions fit.
+    /// - `out` buckets grow with the chain, by one field per 65536 transactions; with
+    ///   `hash-max-listpack-entries 512` they fit up to about 33 million transactions that pay to an address,
+    ///   and values (16 bytes per output) fit 1024 bytes up to 64 outputs.
+    /// - `ids` is a single hash over all addresses and is a hashtable on any real chain.
+    class CompactSchema
+    {
+    public:
+        static size_t constexpr bucket_size{128};
+        static size_t constexpr output_record_size{16};
+        static size_t constexpr history_record_size{12};
+
+        std::vector<command_t> block_commands(blockparser::Block const& block, uint256 const& hash,
+                                              blockparser::BlockDelta const& delta);
+
+        static command_t top_command(size_t height);
+
+    private:
+        blockparser::AddressTable addresses_{};
+        std::vector<uint32_t> history_records_{}; // by address id
+    };
+} // namespace redis
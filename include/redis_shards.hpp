@@ -0,0 +1,71 @@
+#pragma once
+
+#include "redis_writer.hpp"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace redis
+{
+    /// A redis server; port 0 denotes a unix socket at `host`.
+    struct Endpoint
+    {
+        std::string host{};
+        size_t port{};
+    };
+
+    inline bool operator==(Endpoint const& lhs, Endpoint const& rhs)
+    {
+        return lhs.host == rhs.host && lhs.port == rhs.port;
+    }
+
+    /// Parse a comma separated list of host:port pairs and unix socket paths (starting with '/').
+    std::vector<Endpoint> parse_endpoints(std::string const& list);
+
+    size_t constexpr cluster_slots{16384};
+
+    /// The redis cluster hash slot of key: CRC16 of the key, or of the first non-empty `{tag}` in it.
+    size_t key_slot(std::string const& key);
+
+    /// Routes commands by key to one PipelinedWriter per server, so that all connections load in parallel.
+    /// With `cluster`, the servers are the nodes of a redis cluster: the slot map is read from the first
+    /// endpoint (CLUSTER SLOTS) and every command goes to the master owning the slot of its key.
+    /// Otherwise the servers are independent instances (client side sharding) and a key is stored on
+    /// server `slot % count`, so keys sharing a `{tag}` are stored together in both cases.
+    class ShardedWriter
+    {
+    public:
+        ShardedWriter(std::vector<Endpoint> const& endpoints, bool cluster,
+                      PipelinedWriter::Options const& options = {});
+
+        /// Read the progress markers of all shards for schema. Returns the height to continue from, the
+        /// lowest next height of all shards; shards that got further skip the blocks they already stored.
+        size_t read_progress(std::string const& schema);
+
+        /// Send the commands of the block at height.
+        void send(std::vector<command_t> commands, size_t height);
+
+        /// Mark all blocks up to height as stored. The marker of each shard is sent on the connection that
+        /// carried its commands, so redis has processed all of them before it sees the marker.
+        void checkpoint(size_t height);
+
+        /// Flush all shards; throws a RedisException if any of them had failed commands.
+        void flush();
+
+        size_t shards() const { return writers_.size(); }
+        size_t sent() const;
+        size_t peak_inflight_bytes() const; // sum of the peaks of all shards
+
+    private:
+        std::vector<std::unique_ptr<PipelinedWriter>> writers_{};
+        std::array<uint16_t, cluster_slots> slot_writer_{};
+
+        std::vector<std::string> marker_keys_{}; // by shard, tagged to be stored on it
+        std::vector<size_t> next_heights_{};     // by shard, as read from the markers
+
+        size_t shard(command_t const& command) const { return slot_writer_[key_slot(command.at(1))]; }
+        void map_cluster_slots(Endpoint const& seed, PipelinedWriter::Options const& options);
+    };
+} // namespace redis
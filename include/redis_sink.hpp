@@ -0,0 +1,43 @@
+#pragma once
+
+#include "redis_shards.hpp"
+#include "sink.hpp"
+
+#include <optional>
+
+namespace redis
+{
+    /// Stores the chain in redis with a key schema, through a ShardedWriter. Continues after the progress
+    /// markers of the schema, and marks progress every `checkpoint_blocks` blocks and on `flush`. Every block
+    /// from genesis is still fed to the schema, which may keep state across blocks (the address ids and history
+    /// offsets of the compact schema); the writer drops the commands of the blocks a shard has stored already.
+    class RedisSink : public blockparser::Sink
+    {
+    public:
+        RedisSink(Schema schema, ShardedWriter& writer, size_t checkpoint_blocks);
+
+        /// The height storing continues from, the lowest next height of all shards.
+        size_t resume_height() const { return resume_height_; }
+
+        void begin_block(blockparser::Block const& block, uint256 const& hash, size_t height) override;
+        void put_output(blockparser::OutPoint const& outpoint, blockparser::Coin const& coin) override;
+        void spend(blockparser::OutPoint const& outpoint, blockparser::Coin const& coin) override;
+        void end_block(blockparser::UtxoSet const& utxos) override;
+
+        void flush() override;
+
+    private:
+        Schema const schema_;
+        ShardedWriter& writer_;
+        size_t const checkpoint_blocks_;
+        size_t resume_height_{};
+
+        // the block being fed
+        blockparser::Block const* block_{};
+        uint256 hash_{};
+        size_t height_{};
+        blockparser::BlockDelta delta_{};
+
+        std::optional<size_t> unmarked_{}; // the last block stored since the last progress marker
+    };
+} // namespace redis
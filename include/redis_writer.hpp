@@ -0,0 +1,92 @@
+#pragma once
+
+#include "redis_commands.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cpp_redis/cpp_redis>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace redis
+{
+    /// Writes commands through a single connection without waiting for replies in between.
+    /// Commands are queued by the caller and sent from a dedicated I/O thread in pipelines of up to
+    /// `batch_commands` commands, each followed by a single commit. The bytes of all queued and unanswered
+    /// commands are capped by `max_inflight_bytes`; `send` blocks while the cap is reached.
+    /// Replies are checked in their callbacks; error replies are counted and reported by `flush`.
+    /// If the connection drops or the I/O thread fails, waiting callers are woken and `send`, `flush` and `get`
+    /// throw a RedisException from then on.
+    class PipelinedWriter
+    {
+    public:
+        struct Options
+        {
+            std::string host{"127.0.0.1"};
+            size_t port{6379};
+            size_t batch_commands{8192};
+            size_t max_inflight_bytes{64u << 20};
+        };
+
+        PipelinedWriter() : PipelinedWriter{Options{}} {}
+        explicit PipelinedWriter(Options options);
+        ~PipelinedWriter();
+
+        PipelinedWriter(PipelinedWriter const&) = delete;
+        PipelinedWriter& operator=(PipelinedWriter const&) = delete;
+
+        void send(command_t command);
+        void send(std::vector<command_t> commands);
+
+        /// GET key, after everything queued so far; nullopt if the key doesn't exist.
+        std::optional<std::string> get(std::string const& key);
+
+        /// Send everything queued and wait for all replies. Throws a RedisException if any reply
+        /// since the last flush was an error.
+        void flush();
+
+        size_t sent() const { return sent_; }
+        size_t peak_inflight_bytes() const { return peak_inflight_; }
+
+    private:
+        struct Queued
+        {
+            command_t command{};
+            size_t bytes{};
+        };
+
+        Options const options_;
+        cpp_redis::client client_{};
+        std::atomic_bool connected_{false};
+
+        std::mutex mutex_{};
+        std::condition_variable queued_cv_{};    // wakes the I/O thread
+        std::condition_variable drained_cv_{};   // wakes senders waiting for capacity or replies
+        std::condition_variable connected_cv_{}; // wakes the constructor once connected
+
+        std::deque<Queued> queue_{};
+        size_t queued_bytes_{};
+        size_t inflight_bytes_{}; // queued and unanswered
+        size_t unanswered_{};
+        bool flushing_{};
+        bool stopping_{};
+
+        size_t errors_{};
+        std::string first_error_{};
+        std::string failure_{}; // why the connection can't be used any more, if so
+
+        size_t sent_{};
+        size_t peak_inflight_{};
+
+        std::thread io_thread_{};
+
+        void run();
+        void fail(std::string const& reason);
+        void throw_if_failed() const; // with mutex_ held
+        void on_reply(cpp_redis::reply const& reply, std::string const& key, size_t bytes);
+    };
+} // namespace redis
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "sink.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace blockparser
+{
+    /// Sums the stake and node rewards per address and bucket of blocks (or days, by block time), as a Sink. The
+    /// reward outputs of the blocks are collected in chunks, which are aggregated into partial maps on up to
+    /// `threads` threads while the chain is read; the partial maps are merged into the sorted table.
+    /// The stake reward of an extended pos coinbase is its stake outputs minus the staked input.
+    class RewardSink : public Sink
+    {
+    public:
+        struct Options
+        {
+            size_t bucket{10000}; // blocks, or days if `days`
+            bool days{};
+            size_t from{};          // first height
+            size_t to{SIZE_MAX};    // last height
+            size_t threads{4};
+        };
+
+        struct Total
+        {
+            int64_t stake{};
+            uint32_t stakes{};
+            int64_t node{};
+            uint32_t nodes{};
+        };
+
+        /// (bucket, address) to totals; buckets are numbered from 0 (height / bucket or days since epoch / bucket).
+        using table_t = std::map<std::pair<uint64_t, std::string>, Total>;
+
+        explicit RewardSink(Options options) : options_{std::move(options)} {}
+
+        size_t next_height() const override { return options_.from; }
+
+        void begin_block(Block const& block, uint256 const& hash, size_t height) override;
+        void put_output(OutPoint const&, Coin const&) override {}
+        void spend(OutPoint const& outpoint, Coin const& coin) override;
+        void end_block(UtxoSet const& utxos) override;
+
+        /// Aggregate the remaining rewards and merge all partial maps.
+        void flush() override;
+
+        /// Complete after `flush`.
+        table_t const& table() const { return table_; }
+
+    private:
+        static size_t constexpr chunk_rewards{1 << 16};
+
+        struct Reward
+        {
+            uint64_t bucket{};
+            std::string address{};
+            int64_t amount{};
+            bool node{};
+        };
+
+        using partial_t = std::unordered_map<uint64_t, std::unordered_map<std::string, Total>>;
+
+        // a reward transaction of the block being fed
+        struct Pending
+        {
+            std::string staker{};
+            int64_t stake{};
+            int64_t staked{}; // claimed by its inputs
+            std::string node{};
+            int64_t node_amount{};
+        };
+
+        Options const options_;
+
+        std::vector<Reward> rewards_{}; // of the chunk being collected
+        std::deque<std::future<partial_t>> aggregating_{};
+        table_t table_{};
+
+        std::vector<Pending> pending_{};
+        std::vector<size_t> claiming_{}; // the pending tx of each input that claims an output (or npos), in order
+        size_t claimed_{};
+        uint64_t bucket_{};
+
+        static partial_t aggregate(std::vector<Reward> rewards);
+        void submit();
+        void merge_front();
+    };
+} // namespace blockparser
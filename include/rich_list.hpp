@@ -0,0 +1,54 @@
+#pragma once
+
+#include "sink.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace blockparser
+{
+    /// Takes the top balances and the concentration of the balances at chosen heights, as a Sink. The balances are
+    /// those the UTXO set keeps per address; the top ones are selected with nth_element and only they are sorted
+    /// with their addresses. The Gini coefficient is over all addresses with a positive balance, whose values are
+    /// sorted for it (without the addresses).
+    class RichListSink : public Sink
+    {
+    public:
+        struct Options
+        {
+            std::vector<size_t> heights{}; // the tip if empty
+            size_t top{100};
+        };
+
+        struct Distribution
+        {
+            size_t height{};
+            size_t holders{}; // addresses with a positive balance
+            int64_t total{};  // of their balances
+            double gini{};
+            int64_t top_total{}; // of the top balances
+            std::vector<std::pair<std::string, int64_t>> top{}; // by balance (descending), then address
+        };
+
+        explicit RichListSink(Options options);
+
+        void begin_block(Block const&, uint256 const&, size_t height) override { height_ = height; }
+        void put_output(OutPoint const&, Coin const&) override {}
+        void spend(OutPoint const&, Coin const&) override {}
+        void end_block(UtxoSet const& utxos) override;
+        void flush() override;
+
+        /// By height; complete after `flush`.
+        std::vector<Distribution> const& distributions() const { return distributions_; }
+
+    private:
+        Options options_;
+
+        size_t height_{};
+        UtxoSet const* utxos_{}; // after the last block fed
+        std::vector<Distribution> distributions_{};
+
+        void take(UtxoSet const& utxos);
+    };
+} // namespace blockparser
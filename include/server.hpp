@@ -0,0 +1,103 @@
+#pragma once
+
+#include "query_index.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace blockparser
+{
+    /// The answer to one request line of the query protocol, as one line of JSON (without the newline):
+    /// - `balance <address> [<height>]` the balance after the block at height (default the tip)
+    /// - `utxos <address>` the unspent outputs of an address at the tip
+    /// - `blocks <height> [<radius>]` the blocks from height - radius to height + radius (default 5)
+    /// - `inputs <txid>` the outputs claimed by a transaction, with address and amount
+    /// - `spenders <txid>` the transactions that claimed the outputs of a transaction
+    /// - `spenders <address>` the transactions that claimed outputs of an address
+    /// - `prefix <prefix> [<limit>]` the number of addresses starting with prefix (ignoring case) and the first
+    ///   limit of them (default 20)
+    /// Malformed requests are answered with `{"error": "..."}`.
+    std::string answer(QueryIndex const& index, std::string const& request);
+
+    /// Serves the query protocol over TCP. One thread runs an epoll loop over all connections; requests are
+    /// answered by a pool of workers. A connection has at most one request in work, so its answers arrive in
+    /// the order of its requests.
+    class QueryServer
+    {
+    public:
+        struct Options
+        {
+            std::string host{"127.0.0.1"};
+            uint16_t port{8335};
+            size_t workers{4};
+        };
+
+        /// Listen on host:port; throws a ServerException if that fails. The index must outlive the server.
+        QueryServer(QueryIndex const& index, Options options);
+        ~QueryServer();
+
+        QueryServer(QueryServer const&) = delete;
+        QueryServer& operator=(QueryServer const&) = delete;
+
+        /// Serve until `stop` is called.
+        void run();
+
+        /// Make `run` return; may be called from any thread.
+        void stop();
+
+        uint16_t port() const { return port_; }
+
+    private:
+        static size_t constexpr max_request_bytes{4096};
+
+        struct Connection
+        {
+            int fd{-1};
+            std::string in{};
+            std::string out{};
+            bool busy{};       // a request of the connection is in work
+            bool closing{};    // the peer closed its side
+            uint32_t events{}; // registered with epoll
+        };
+
+        struct Job
+        {
+            uint64_t connection{};
+            std::string request{};
+        };
+
+        QueryIndex const& index_;
+        Options const options_;
+        uint16_t port_{};
+
+        int listen_fd_{-1};
+        int epoll_fd_{-1};
+        int event_fd_{-1}; // wakes the loop for answers and `stop`
+
+        std::unordered_map<uint64_t, Connection> connections_{};
+        uint64_t next_connection_{};
+
+        std::mutex mutex_{};
+        std::condition_variable jobs_cv_{};
+        std::deque<Job> jobs_{};
+        std::vector<Job> answers_{};
+        bool stopping_{};
+        std::atomic<bool> stop_{};
+        std::vector<std::thread> workers_{};
+
+        void accept_connections();
+        void read(uint64_t id, Connection& connection);
+        void write(uint64_t id, Connection& connection);
+        void dispatch(uint64_t id, Connection& connection);
+        void watch(uint64_t id, Connection& connection);
+        void deliver_answers();
+        void close(uint64_t id);
+        void work();
+    };
+} // namespace blockparser
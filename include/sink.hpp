@@ -0,0 +1,28 @@
+#pragma once
+
+#include "block.hpp"
+#include "utxo.hpp"
+
+namespace blockparser
+{
+    /// A storage backend fed with the main chain by ChainApplier::run. For every block the applier calls
+    /// `begin_block`, then `put_output` for each output created and `spend` for each output claimed by the block
+    /// (both from the block's BlockDelta, in transaction order), and `end_block` with the UTXO set after the
+    /// block. `flush` is called once all blocks have been fed.
+    class Sink
+    {
+    public:
+        virtual ~Sink() = default;
+
+        /// Height of the first block the sink doesn't store yet. Blocks below are still applied to the UTXO set,
+        /// but not fed to the sink.
+        virtual size_t next_height() const { return 0; }
+
+        virtual void begin_block(Block const& block, uint256 const& hash, size_t height) = 0;
+        virtual void put_output(OutPoint const& outpoint, Coin const& coin) = 0;
+        virtual void spend(OutPoint const& outpoint, Coin const& coin) = 0;
+        virtual void end_block(UtxoSet const& utxos) = 0;
+
+        virtual void flush() = 0;
+    };
+} // namespace blockparser
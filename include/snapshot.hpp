@@ -0,0 +1,117 @@
+#pragma once
+
+#include "utxo.hpp"
+
+#include <cstring>
+#include <optional>
+#include <string>
+
+namespace blockparser
+{
+    /// On-disk layout of a UTXO snapshot (little endian, fixed size records):
+    ///   SnapshotHeader
+    ///   SnapshotCoin[coin_count]       sorted by (hash bytes, index)
+    ///   SnapshotBalance[balance_count] sorted by address
+    /// The checksum is the SHA256 over the header (with the checksum zeroed) and both record arrays.
+    namespace snapshot
+    {
+        static char constexpr magic[8]{'Z', 'N', 'N', 'U', 'T', 'X', 'O', '\0'};
+        static uint32_t constexpr version{3};
+        static size_t constexpr address_size{34};
+
+        struct SnapshotHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t reserved;
+            uint64_t height;
+            uint8_t tip[32];
+            uint64_t coin_count;
+            uint64_t balance_count;
+            uint8_t checksum[32];
+            int64_t zerocoin_pool;
+        };
+
+        struct SnapshotCoin
+        {
+            uint8_t hash[32];
+            uint32_t index;
+            uint32_t height;
+            int64_t amount;
+            char address[address_size]; // zero padded, empty for nonstandard outputs
+            char padding[6];
+        };
+
+        struct SnapshotBalance
+        {
+            char address[address_size];
+            char padding[6];
+            int64_t balance;
+        };
+
+        static_assert(sizeof(SnapshotHeader) == 112);
+        static_assert(sizeof(SnapshotCoin) == 88);
+        static_assert(sizeof(SnapshotBalance) == 48);
+
+        inline bool operator<(SnapshotCoin const& lhs, SnapshotCoin const& rhs)
+        {
+            auto const cmp{std::memcmp(lhs.hash, rhs.hash, sizeof(lhs.hash))};
+            return cmp < 0 || (cmp == 0 && lhs.index < rhs.index);
+        }
+
+        inline bool operator<(SnapshotBalance const& lhs, SnapshotBalance const& rhs)
+        {
+            return std::memcmp(lhs.address, rhs.address, address_size) < 0;
+        }
+
+        inline std::string address(char const (&field)[address_size])
+        {
+            return std::string{field, strnlen(field, address_size)};
+        }
+    } // namespace snapshot
+
+    /// Write the state of `utxos` to `path`. The file is written to a temporary and renamed,
+    /// so an existing snapshot is only replaced by a complete one.
+    void write_snapshot(std::string const& path, UtxoSet const& utxos);
+
+    /// Read-only, memory mapped view of a snapshot file. The constructor validates magic,
+    /// version, size and checksum and throws a SnapshotException on mismatch.
+    class MappedSnapshot
+    {
+    public:
+        explicit MappedSnapshot(std::string const& path);
+        ~MappedSnapshot();
+
+        MappedSnapshot(MappedSnapshot const&) = delete;
+        MappedSnapshot& operator=(MappedSnapshot const&) = delete;
+
+        size_t height() const { return header_->height; }
+        uint256 tip() const;
+
+        snapshot::SnapshotCoin const* coins() const { return coins_; }
+        size_t coin_count() const { return header_->coin_count; }
+
+        snapshot::SnapshotBalance const* balances() const { return balances_; }
+        size_t balance_count() const { return header_->balance_count; }
+
+        /// The amount held by zerocoins, which is not in any output.
+        int64_t zerocoin_pool() const { return header_->zerocoin_pool; }
+
+        /// Binary search for an unspent output.
+        snapshot::SnapshotCoin const* find(OutPoint const& outpoint) const;
+
+        /// Binary search for the balance of an address.
+        std::optional<int64_t> balance(std::string const& address) const;
+
+        /// Materialize the mapped state into a mutable set, to continue applying blocks.
+        UtxoSet to_utxo_set() const;
+
+    private:
+        void* data_{};
+        size_t size_{};
+
+        snapshot::SnapshotHeader const* header_{};
+        snapshot::SnapshotCoin const* coins_{};
+        snapshot::SnapshotBalance const* balances_{};
+    };
+} // namespace blockparser
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "sink.hpp"
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace blockparser
+{
+    /// Layout of the binary supply table (little endian): SupplyHeader, then one SupplyRecord per height from 0.
+    namespace supply
+    {
+        static char constexpr magic[8]{'Z', 'N', 'N', 'S', 'U', 'P', 'L', '\0'};
+        static uint32_t constexpr version{2};
+
+        enum Phase : uint8_t
+        {
+            pow     = 0,
+            pos     = 1,
+            pos_ext = 2,
+        };
+
+        struct SupplyHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t record_size;
+        };
+
+        struct SupplyRecord
+        {
+            int64_t minted;   // outputs of the coinbase and coinstake txs, minus the staked inputs
+            int64_t fees;     // inputs (including zerocoin spends) minus outputs of the other txs
+            int64_t supply;   // after the block: the sum of minted minus fees up to here
+            int64_t zerocoin; // of the supply, held by the zerocoin pool after the block
+            uint32_t utxos;   // unspent outputs after the block
+            uint8_t phase;
+            uint8_t padding[3];
+        };
+
+        static_assert(sizeof(SupplyHeader) == 16);
+        static_assert(sizeof(SupplyRecord) == 40);
+    } // namespace supply
+
+    /// Streams the money supply per height to a file, as a Sink: what each block minted, the fees its regular txs
+    /// paid (which the minting txs collect, so the supply grows by minted - fees), the supply, the zerocoin pool
+    /// and the number of unspent outputs after the block, and the consensus phase (pow, pos, extended pos
+    /// coinbase) of its minting tx. Regular txs that pay out more than they claim are counted as anomalies.
+    class SupplySink : public Sink
+    {
+    public:
+        enum class Format
+        {
+            binary, // the supply table
+            csv     // height,phase,minted,fees,supply,zerocoin,utxos
+        };
+
+        SupplySink(std::string const& path, Format format);
+
+        void begin_block(Block const& block, uint256 const& hash, size_t height) override;
+        void put_output(OutPoint const&, Coin const&) override {}
+        void spend(OutPoint const& outpoint, Coin const& coin) override;
+        void end_block(UtxoSet const& utxos) override;
+        void flush() override;
+
+        /// After the last block fed.
+        int64_t supply() const { return supply_; }
+        size_t anomalies() const { return anomalies_; }
+
+    private:
+        struct Pending
+        {
+            bool minting{};
+            int64_t in{};
+            int64_t out{};
+        };
+
+        std::string const path_;
+        Format const format_;
+        std::ofstream file_;
+
+        int64_t supply_{};
+        size_t anomalies_{};
+        size_t height_{};
+        uint8_t phase_{supply::pow};
+
+        std::vector<Pending> pending_{};
+        std::vector<size_t> claiming_{}; // the pending tx of each input that claims an output, in order
+        size_t claimed_{};
+    };
+
+    /// Counts zerocoin mints and spends per denomination, as a Sink, and writes a CSV row
+    /// `height,denomination,mints,spends,minted,spent,pool` for every height and denomination with any. The
+    /// denomination of a mint is that of its amount (AmountToZerocoinDenomination), that of a spend is in its
+    /// sequence field; amounts that are no denomination are counted under 0. Pool is the zerocoin pool after the
+    /// block.
+    class ZerocoinSink : public Sink
+    {
+    public:
+        struct Total
+        {
+            uint64_t mints{};
+            uint64_t spends{};
+            int64_t minted{};
+            int64_t spent{};
+        };
+
+        explicit ZerocoinSink(std::string const& path);
+
+        void begin_block(Block const& block, uint256 const& hash, size_t height) override;
+        void put_output(OutPoint const&, Coin const&) override {}
+        void spend(OutPoint const&, Coin const&) override {}
+        void end_block(UtxoSet const& utxos) override;
+        void flush() override;
+
+        /// By denomination, over all blocks fed.
+        std::map<int64_t, Total> const& totals() const { return totals_; }
+
+    private:
+        std::string const path_;
+        std::ofstream file_;
+
+        std::map<int64_t, Total> totals_{};
+        std::map<int64_t, Total> block_{}; // of the block being fed
+        size_t height_{};
+    };
+} // namespace blockparser
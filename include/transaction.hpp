@@ -15,6 +15,9 @@ namespace blockparser
         uint32_t locktime{}; // a block height or unix time (google locktime parsing)
         uint256 hash{};
 
+        uint32_t offset{}; // position of the serialized tx, relative to the start of the block
+        uint32_t size{};   // length of the serialized tx
+
         std::vector<TxInput> vin{};
         std::vector<TxOutput> vout{};
     };
@@ -45,6 +48,17 @@ namespace blockparser
 
     Transaction read_transaction(std::ifstream& stream);
 
+    /// The consensus phase seen so far by assert_schema_matches_assumption.
+    struct SchemaPhase
+    {
+        int phase{}; // 0 pow, 1 pos, 2 extended pos coinbase
+        bool seen_regular_tx{};
+    };
+
+    /// Validates that the interpretation of transaction types is correct. Tracks the transition from
+    /// PoW to PoS in `state`, so it has to see the transactions in chain order from genesis.
+    void assert_schema_matches_assumption(Transaction const& tx, SchemaPhase& state);
+
     /// Transaction types:
     /// PoS Coinbase: output 0 is empty (nonstandard type); output 1 contains staking reward; output n-1 contains node
     /// reward.
@@ -55,7 +69,7 @@ namespace blockparser
     /// a pow coinbase transaction has one output and one input with no matching output
     inline auto is_pow_coinbase(Transaction const& tx) -> bool
     {
-        return tx.vin.size() == 1 && tx.vout.size() == 1 && !claims_output(tx.vin[0]);
+        return tx.vin.size() == 1 && tx.vout.size() == 1 && is_coinbase_input(tx.vin[0]);
     }
 
     // coinbase transaction with 1 in, 1 out and zero movement
@@ -69,7 +83,7 @@ namespace blockparser
     /// a pos coinbase transaction has two outputs (stake, node) and one input with no matching output
     inline auto is_pos_coinbase(Transaction const& tx) -> bool
     {
-        return tx.vin.size() == 1 && tx.vout.size() == 2 && !claims_output(tx.vin[0]) && !empty(tx.vout[0]);
+        return tx.vin.size() == 1 && tx.vout.size() == 2 && is_coinbase_input(tx.vin[0]) && !empty(tx.vout[0]);
     }
 
     /// a pos coinbase tx with an additional valid input
@@ -86,14 +100,18 @@ namespace blockparser
         return tx.vout.size() >= 2 && empty(tx.vout[0]);
     }
     */
+    /// a stake reward is output 0 of a pos coinbase, or one of the outputs between the empty marker and the node
+    /// reward of an extended pos coinbase (those include the staked input)
     inline auto is_coinstake(Transaction const& tx, TxOutput const& out) -> bool
     {
-        return is_pos_coinbase(tx) && tx.vout.size() == 2 && &tx.vout[1] == &out;
+        if (is_pos_coinbase(tx)) return &tx.vout.front() == &out;
+        return is_pos_coinbase_ext(tx) && &tx.vout.front() != &out && &tx.vout.back() != &out;
     }
 
+    /// a node reward is the last output of a (extended) pos coinbase
     inline auto is_nodereward(Transaction const& tx, TxOutput const& out) -> bool
     {
-        return is_pos_coinbase(tx) && &tx.vout.back() == &out;
+        return (is_pos_coinbase(tx) || is_pos_coinbase_ext(tx)) && &tx.vout.back() == &out;
     }
 
     /*
@@ -114,6 +132,13 @@ namespace blockparser
                 return std::hash<std::string>{}(value.ToString());
             }
         };
+
+        /// Hash functor for uint256 values that are hash digests themselves (block and tx hashes);
+        /// their low 64 bits are uniformly distributed.
+        struct uint256_cheap_hash
+        {
+            std::size_t operator()(uint256 const& value) const noexcept { return value.GetLow64(); }
+        };
     } // namespace detail
 
     using TxMap = std::unordered_map<uint256, uint256, detail::uint256_hash>;
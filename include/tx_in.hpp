@@ -1,6 +1,7 @@
 #pragma once
 
 #include "types.hpp"
+#include "znn_constants.hpp"
 
 #include <fstream>
 #include <iomanip>
@@ -25,6 +26,19 @@ namespace blockparser
         return !(vin.tx_hash.IsNull() && vin.index == std::numeric_limits<uint32_t>::max());
     }
 
+    /// A zerocoin spend claims no output but a coin of the zerocoin pool, whose denomination is in the sequence
+    /// field (zenon: CTxIn of a CoinSpend). Like a coinbase input, its outpoint is null.
+    inline bool is_zerocoin_spend(TxInput const& vin)
+    {
+        return !vin.script_sig.data.empty() && vin.script_sig.data.front() == OP_ZEROCOINSPEND;
+    }
+
+    /// The amount a zerocoin spend takes out of the pool; 0 for an invalid denomination.
+    int64_t zerocoin_spend_amount(TxInput const& vin);
+
+    /// The input of a coinbase claims neither an output nor a zerocoin.
+    inline bool is_coinbase_input(TxInput const& vin) { return !claims_output(vin) && !is_zerocoin_spend(vin); }
+
     inline auto operator<<(std::ostream& os, TxInput const& tx) -> std::ostream&
     {
         os << std::setw(20) << "[Idx " << tx.index << " Seq " << tx.sequence << "] " << tx.tx_hash.ToString()
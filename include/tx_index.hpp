@@ -0,0 +1,54 @@
+#pragma once
+
+#include "block.hpp"
+#include "chain_index.hpp"
+
+#include <string>
+#include <vector>
+
+namespace blockparser
+{
+    /// Location of a serialized transaction. Keyed by the low 64 bits of the txid only; lookups
+    /// can yield several candidates, which are told apart by hashing the transaction.
+    struct TxLocation
+    {
+        uint64_t prefix{};
+        uint32_t file{};
+        uint32_t block_offset{}; // behind the block length field, as BlockLocation::offset
+        uint32_t tx_offset{};    // relative to block_offset
+        uint32_t size{};
+    };
+
+    static_assert(sizeof(TxLocation) == 24);
+
+    inline uint64_t txid_prefix(uint256 const& txid) { return txid.GetLow64(); }
+
+    /// txid -> location index over the main chain, persisted as a sorted, checksummed file.
+    class TxIndex
+    {
+    public:
+        /// Add the transactions of the block at `height`, which has to follow the current tip.
+        void add(Block const& block, ChainEntry const& entry, size_t height);
+
+        /// All locations whose key matches the txid (usually one).
+        std::vector<TxLocation> find(uint256 const& txid);
+
+        void save(std::string const& path);
+
+        /// Restore a persisted index. Returns false if the file is missing or invalid.
+        bool load(std::string const& path);
+
+        uint256 const& tip() const { return tip_; }
+        size_t next_height() const { return next_height_; }
+        size_t size() const { return locations_.size(); }
+
+    private:
+        std::vector<TxLocation> locations_{};
+        bool sorted_{true};
+
+        uint256 tip_{};
+        size_t next_height_{};
+
+        void sort();
+    };
+} // namespace blockparser
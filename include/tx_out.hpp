@@ -21,6 +21,7 @@ namespace blockparser
         DATA,
         PUZZLE,
         EMPTY,
+        ZEROCOINMINT,
         NONSTANDARD
     };
 
@@ -38,7 +39,7 @@ namespace blockparser
             {script_t::PKH, "Pay-to-pubkey-hash"},  {script_t::PK, "Pay-to-pubkey"},
             {script_t::P2SH, "Pay-to-script-hash"}, {script_t::DATA, "Data"},
             {script_t::PUZZLE, "Puzzle"},           {script_t::EMPTY, "Empty"},
-            {script_t::NONSTANDARD, "Non-Standard"}};
+            {script_t::ZEROCOINMINT, "Zerocoin-Mint"}, {script_t::NONSTANDARD, "Non-Standard"}};
 
         os << names.at(type);
         return os;
@@ -96,6 +97,13 @@ namespace blockparser
         return pubkey.data.size() && pubkey.data.front() == OP_HASH256 && pubkey.data.back() == OP_EQUAL;
     }
 
+    // Moves the amount into the zerocoin pool; the script carries the coin's public commitment.
+    // zenon: script.cpp:IsZerocoinMint
+    inline bool is_zerocoin_mint(PubKey const& pubkey)
+    {
+        return !pubkey.data.empty() && pubkey.data.front() == OP_ZEROCOINMINT;
+    }
+
     inline bool is_null_data(PubKey const& pubkey)
     {
         // std::cout << pubkey << std::endl;
@@ -174,6 +182,7 @@ namespace blockparser
         if (output.script_pubkey.data.empty()) return std::make_pair(script_t::EMPTY, uint160{});
         if (is_puzzle(output.script_pubkey)) return std::make_pair(script_t::PUZZLE, uint160{});
         if (is_unspendable(output.script_pubkey)) return std::make_pair(script_t::DATA, uint160{});
+        if (is_zerocoin_mint(output.script_pubkey)) return std::make_pair(script_t::ZEROCOINMINT, uint160{});
 
         return std::make_pair(script_t::NONSTANDARD, uint160{});
     }
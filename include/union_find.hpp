@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace blockparser
+{
+    /// Union-find over the ids 0..size-1 that any number of threads may `unite` and `find` on concurrently,
+    /// without locks. Roots are only ever linked below a smaller id, with a CAS that fails if the root got linked
+    /// meanwhile, so the structure stays a forest and the root of a set is its smallest id. `find` halves paths.
+    class ConcurrentUnionFind
+    {
+    public:
+        explicit ConcurrentUnionFind(size_t size) : size_{size}, parents_{new std::atomic<uint32_t>[size]}
+        {
+            for (size_t i{}; i < size; ++i)
+            {
+                parents_[i].store(static_cast<uint32_t>(i), std::memory_order_relaxed);
+            }
+        }
+
+        size_t size() const { return size_; }
+
+        uint32_t find(uint32_t id)
+        {
+            while (true)
+            {
+                auto parent{parents_[id].load(std::memory_order_acquire)};
+                if (parent == id) return id;
+
+                // point to the grandparent; losing the race to another thread is fine
+                auto const grandparent{parents_[parent].load(std::memory_order_acquire)};
+                if (parent != grandparent)
+                {
+                    parents_[id].compare_exchange_weak(parent, grandparent, std::memory_order_release,
+                                                       std::memory_order_relaxed);
+                }
+                id = grandparent;
+            }
+        }
+
+        void unite(uint32_t a, uint32_t b)
+        {
+            while (true)
+            {
+                a = find(a);
+                b = find(b);
+                if (a == b) return;
+
+                if (a < b) std::swap(a, b);
+
+                // link the larger root below the smaller one, unless it stopped being a root
+                auto expected{a};
+                if (parents_[a].compare_exchange_strong(expected, b, std::memory_order_acq_rel)) return;
+            }
+        }
+
+    private:
+        size_t size_;
+        std::unique_ptr<std::atomic<uint32_t>[]> parents_;
+    };
+} // namespace blockparser
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "block.hpp"
+#include "exception.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace blockparser
+{
+    /// Reference to a transaction output (COutPoint).
+    struct OutPoint
+    {
+        uint256 hash{};
+        uint32_t index{};
+    };
+
+    inline bool operator==(OutPoint const& lhs, OutPoint const& rhs)
+    {
+        return lhs.index == rhs.index && lhs.hash == rhs.hash;
+    }
+
+    /// An unspent output: the claimed amount, the receiving address (empty for nonstandard outputs)
+    /// and the height of the block that created it.
+    struct Coin
+    {
+        int64_t amount{};
+        uint32_t height{};
+        std::string address{};
+    };
+
+    namespace detail
+    {
+        /// Tx hashes are uniformly distributed; the low 64 bits are a sufficient hash.
+        struct outpoint_hash
+        {
+            std::size_t operator()(OutPoint const& outpoint) const noexcept
+            {
+                return outpoint.hash.GetLow64() ^ (static_cast<uint64_t>(outpoint.index) * 0x9e3779b97f4a7c15ull);
+            }
+        };
+    } // namespace detail
+
+    /// The effect of a block on the UTXO set, in transaction order.
+    struct BlockDelta
+    {
+        std::vector<std::pair<OutPoint, Coin>> created{};
+        std::vector<std::pair<OutPoint, Coin>> spent{};
+    };
+
+    /// The derived state at a given tip: all unspent outputs, the balance per address and the zerocoin pool.
+    class UtxoSet
+    {
+    public:
+        using coin_map_t    = std::unordered_map<OutPoint, Coin, detail::outpoint_hash>;
+        using balance_map_t = std::unordered_map<std::string, int64_t>;
+
+        /// Apply the block at `height` on top of the current tip. Throws an UtxoException if
+        /// the block doesn't extend the tip or an input claims an unknown output.
+        BlockDelta apply(Block const& block, uint256 const& hash, size_t height);
+
+        /// Insert an unspent output directly (used when restoring a snapshot).
+        void restore(OutPoint outpoint, Coin coin) { coins_.emplace(std::move(outpoint), std::move(coin)); }
+        void restore_balance(std::string address, int64_t balance) { balances_[std::move(address)] = balance; }
+        void restore_zerocoin_pool(int64_t amount) { zerocoin_pool_ = amount; }
+        void restore_tip(uint256 hash, size_t height)
+        {
+            tip_         = std::move(hash);
+            next_height_ = height + 1;
+        }
+
+        coin_map_t const& coins() const { return coins_; }
+        balance_map_t const& balances() const { return balances_; }
+
+        /// The amount minted into zerocoins and not spent yet; it is held by no output or address.
+        int64_t zerocoin_pool() const { return zerocoin_pool_; }
+
+        Coin const* find(OutPoint const& outpoint) const
+        {
+            auto it{coins_.find(outpoint)};
+            return it == coins_.end() ? nullptr : &it->second;
+        }
+
+        /// Hash of the last applied block; null if no block has been applied.
+        uint256 const& tip() const { return tip_; }
+
+        /// Height of the next block to apply.
+        size_t next_height() const { return next_height_; }
+
+        bool empty() const { return tip_.IsNull(); }
+
+    private:
+        coin_map_t coins_{};
+        balance_map_t balances_{};
+        int64_t zerocoin_pool_{};
+
+        uint256 tip_{};
+        size_t next_height_{};
+    };
+} // namespace blockparser
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "fenwick.hpp"
+#include "sink.hpp"
+
+#include <array>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace blockparser
+{
+    /// Writes the age and amount distributions of the unspent outputs at chosen heights, as a Sink fed from
+    /// genesis. The outputs and amounts by creation height are kept in Fenwick trees and the amount bands in
+    /// counters, all updated from the created and spent outputs of each block, so a histogram at any height is
+    /// O(log² n) instead of a scan of the UTXO set. Rows are `height,histogram,lower,upper,outputs,amount`:
+    /// `age` buckets are 0 and [2^k, 2^(k+1)) blocks up to the height, `amount` bands are 0 and
+    /// [10^k, 10^(k+1)) satoshis with any outputs; upper is exclusive.
+    class UtxoHistogramSink : public Sink
+    {
+    public:
+        struct Options
+        {
+            std::vector<size_t> heights{}; // the tip if empty and no `every`
+            size_t every{};                // also every multiple of every, if not 0
+        };
+
+        UtxoHistogramSink(std::string const& path, Options options);
+
+        void begin_block(Block const&, uint256 const&, size_t height) override { height_ = height; }
+        void put_output(OutPoint const& outpoint, Coin const& coin) override;
+        void spend(OutPoint const& outpoint, Coin const& coin) override;
+        void end_block(UtxoSet const& utxos) override;
+        void flush() override;
+
+        /// The heights histograms were written for.
+        size_t written() const { return written_; }
+
+    private:
+        struct Band
+        {
+            uint64_t outputs{};
+            int64_t amount{};
+        };
+
+        std::string const path_;
+        Options options_;
+        std::ofstream file_;
+
+        FenwickTree<int64_t> outputs_{}; // by creation height
+        FenwickTree<int64_t> amounts_{}; // by creation height
+        std::array<Band, 20> bands_{};   // by the number of decimal digits of the amount
+
+        size_t height_{};
+        bool fed_{};
+        size_t written_{};
+
+        void write(size_t height);
+    };
+} // namespace blockparser
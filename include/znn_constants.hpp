@@ -40,4 +40,7 @@ namespace blockparser
     static unsigned char const OP_HASH256{0xaa};
     static unsigned char const OP_CHECKSIG{0xac};
 
+    static unsigned char const OP_ZEROCOINMINT{0xc1};
+    static unsigned char const OP_ZEROCOINSPEND{0xc2};
+
 } // namespace blockparser
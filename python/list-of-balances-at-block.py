@@ -9,20 +9,13 @@ def get_last_block():
 def get_all_utxos():
     return red.smembers("znn:utxos")
 
-def get_blocks_referencing_utxo(utxo):
-    return red.smembers(f"znn:blocks:{utxo}")
-
-def get_balance_change_for(utxo, height):
-    return int(red.get(f"znn:change:{utxo}:{height}")) # all numbers are in given in zats (no decimals)
-
-# Returns the sum of balance changes for a given utxo until a given block.
+# Returns the balance of a given utxo after a given block, from the sorted set of its balances by height.
 # Returns -1 if the utxo had no transactions until that block.
 def get_balance_for_utxo_at_block(utxo, block):
-    heights = sorted(int(height) for height in get_blocks_referencing_utxo(utxo))
-    if heights[0] > block:
+    last = red.zrevrangebyscore(f"znn:balance:{utxo}", block, "-inf", start=0, num=1)
+    if not last:
         return -1
-    changes = [get_balance_change_for(utxo, height) for height in heights if height <= block]
-    return sum(changes)
+    return int(last[0].decode("utf-8").split(":")[1]) # all numbers are in given in zats (no decimals)
 
 def gen_snapshot(blockheight, outputfile):
     all_utxos = get_all_utxos()
@@ -0,0 +1,32 @@
+-- Hash and transactions of the block at a height in the compact schema (--schema=compact).
+-- KEYS: "height"   ARGV: <height>
+
+local bin2hex = function(bin)
+  return (string.gsub(bin, ".", function(byte) return string.format("%02x", string.byte(byte)) end))
+end
+
+local getblock = function(height)
+  local packed = redis.call("hget", "znn:c:blk:" .. math.floor(height / 128), string.format("%d", height % 128))
+  if not packed then return nil end
+
+  -- block hash, then one hash per transaction
+  local txs = {}
+  for pos = 33, string.len(packed), 32 do
+    table.insert(txs, bin2hex(string.sub(packed, pos, pos + 31)))
+  end
+
+  return {hash = bin2hex(string.sub(packed, 1, 32)), height = height, txs = txs}
+end
+
+
+local result = {error = "wrong argument"}
+
+if KEYS[1] == "height" then
+  local height = tonumber(ARGV[1])
+
+  if height ~= nil then
+    result = {block = getblock(height)}
+  end
+end
+
+return cjson.encode(result)
@@ -0,0 +1,38 @@
+-- Balance changes of an address in the compact schema (--schema=compact), and its balance at a height.
+-- KEYS: "address" [, "height"]   ARGV: <address> [, <height>]
+
+local gethistory = function(address, height)
+  local changes = {}
+  local balance = 0
+
+  local id = redis.call("hget", "znn:c:ids", address)
+  if not id then return changes, balance end
+
+  local packed = redis.call("get", "znn:c:hist:" .. id)
+  if not packed then return changes, balance end
+
+  -- records of height u32, change i64, ascending by height
+  for pos = 1, string.len(packed), 12 do
+    local at, change = struct.unpack("<I4i8", packed, pos)
+    if height ~= nil and at > height then break end
+
+    balance = balance + change
+    table.insert(changes, {height = at, change = string.format("%d", change)})
+  end
+
+  return changes, balance
+end
+
+
+local result = {error = "wrong argument"}
+
+if KEYS[1] == "address" and ARGV[1] ~= nil and ARGV[1] ~= "" then
+  local height = nil
+
+  if KEYS[2] == "height" then height = tonumber(ARGV[2]) end
+
+  local changes, balance = gethistory(ARGV[1], height)
+  result = {changes = changes, balance = string.format("%d", balance)}
+end
+
+return cjson.encode(result)
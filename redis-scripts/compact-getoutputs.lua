@@ -0,0 +1,41 @@
+-- Outputs of a transaction in the compact schema (--schema=compact).
+-- KEYS: "tx" [, "n"]   ARGV: <txid hex> [, <output index>]
+
+local hex2bin = function(hex)
+  return (string.gsub(hex, "..", function(byte) return string.char(tonumber(byte, 16)) end))
+end
+
+local getaddress = function(id)
+  return redis.call("hget", "znn:c:addr:" .. math.floor(id / 128), string.format("%d", id % 128))
+end
+
+local getoutputs = function(txid, n)
+  local bin = hex2bin(txid)
+  local packed = redis.call("hget", "znn:c:out:" .. string.sub(bin, 1, 2), string.sub(bin, 3))
+  local outputs = {}
+
+  if not packed then return outputs end
+
+  -- records of index u32, address id u32, amount i64
+  for pos = 1, string.len(packed), 16 do
+    local index, id, amount = struct.unpack("<I4I4i8", packed, pos)
+    if n == nil or n == index then
+      table.insert(outputs, {n = index, address = getaddress(id), amount = string.format("%d", amount)})
+    end
+  end
+
+  return outputs
+end
+
+
+local result = {error = "wrong argument"}
+
+if KEYS[1] == "tx" and ARGV[1] ~= nil and string.len(ARGV[1]) == 64 then
+  local n = nil
+
+  if KEYS[2] == "n" then n = tonumber(ARGV[2]) end
+
+  result = {outputs = getoutputs(ARGV[1], n)}
+end
+
+return cjson.encode(result)
@@ -1,14 +1,22 @@
-local getutxo = function(key)
-  local prefix = "znn:blocks:"
-  return string.sub(key, string.len(prefix), -1)
+-- Balance of an address at a height, from the sorted set znn:balance:<address> of the default schema.
+-- Its members are <height>:<balance after that block>, scored by height, so this is a single lookup.
+-- KEYS: "address", "height"   ARGV: <address>, <height>
+-- "changed" is the height of the last balance change up to the height; it is missing if there was none.
+
+local balanceat = function(address, height)
+  local last = redis.call("zrevrangebyscore", "znn:balance:" .. address, height, "-inf", "limit", 0, 1)
+  if #last == 0 then return nil, "0" end
+
+  local changed, balance = string.match(last[1], "^(%d+):(-?%d+)$")
+  return tonumber(changed), balance
 end
 
-local convertkeys = function(keys)
-  local converted = {}
-  for i, key in ipairs(keys) do
-    converted[i] = getutxo(key)
-  end
-  return converted
+
+local result = {error = "wrong argument"}
+
+if KEYS[1] == "address" and KEYS[2] == "height" and ARGV[1] ~= nil and ARGV[1] ~= "" and tonumber(ARGV[2]) then
+  local changed, balance = balanceat(ARGV[1], tonumber(ARGV[2]))
+  result = {address = ARGV[1], height = tonumber(ARGV[2]), balance = balance, changed = changed}
 end
 
-return convertkeys(redis.call("smembers", "znn:utxos:*"))
+return cjson.encode(result)
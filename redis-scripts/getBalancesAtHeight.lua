@@ -0,0 +1,34 @@
+-- Balances of all addresses at a height, one batch of znn:utxos per call (see getBalanceAtHeight.lua).
+-- KEYS: "height", "cursor" [, "count"]   ARGV: <height>, <cursor> [, <batch size>, default 1000]
+-- Start with cursor 0 and call again with the returned cursor until it is "0". Addresses without a
+-- transaction up to the height are left out; an address may be returned twice if znn:utxos grows meanwhile.
+
+local balanceat = function(address, height)
+  local last = redis.call("zrevrangebyscore", "znn:balance:" .. address, height, "-inf", "limit", 0, 1)
+  if #last == 0 then return nil end
+
+  local _, balance = string.match(last[1], "^(%d+):(-?%d+)$")
+  return balance
+end
+
+
+local result = {error = "wrong argument"}
+
+if KEYS[1] == "height" and KEYS[2] == "cursor" and tonumber(ARGV[1]) and ARGV[2] ~= nil then
+  local height = tonumber(ARGV[1])
+  local count = 1000
+
+  if KEYS[3] == "count" and tonumber(ARGV[3]) then count = tonumber(ARGV[3]) end
+
+  local scan = redis.call("sscan", "znn:utxos", ARGV[2], "count", count)
+  local balances = {}
+
+  for _, address in ipairs(scan[2]) do
+    local balance = balanceat(address, height)
+    if balance ~= nil then balances[address] = balance end
+  end
+
+  result = {height = height, cursor = scan[1], balances = balances}
+end
+
+return cjson.encode(result)
@@ -0,0 +1,139 @@
+#include "address_index.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+    char fold(char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); }
+
+    std::string fold(std::string s)
+    {
+        std::transform(s.begin(), s.end(), s.begin(), [](char c) { return fold(c); });
+        return s;
+    }
+
+    // Compares the lower case form of s, cut to the length of the (lower case) prefix, with the prefix.
+    int compare(char const* s, size_t length, std::string const& prefix)
+    {
+        for (size_t i{}; i < std::min(length, prefix.size()); ++i)
+        {
+            auto const c{fold(s[i])};
+            if (c != prefix[i]) return c < prefix[i] ? -1 : 1;
+        }
+        return length < prefix.size() ? -1 : 0;
+    }
+} // namespace
+
+blockparser::AddressIndex::AddressIndex(std::vector<std::string> addresses)
+{
+    std::vector<std::pair<std::string, std::string>> keyed;
+    keyed.reserve(addresses.size());
+    for (auto&& address : addresses)
+    {
+        // the encoding stores lengths in a byte
+        address.resize(std::min<size_t>(address.size(), UINT8_MAX));
+        keyed.emplace_back(fold(address), std::move(address));
+    }
+
+    std::sort(keyed.begin(), keyed.end());
+    keyed.erase(std::unique(keyed.begin(), keyed.end()), keyed.end());
+
+    std::string const* previous{};
+    for (auto&& [key, address] : keyed)
+    {
+        size_t shared{};
+        if (size_ % bucket_size == 0)
+        {
+            heads_.push_back(static_cast<uint32_t>(data_.size()));
+        }
+        else
+        {
+            auto const limit{std::min(address.size(), previous->size())};
+            while (shared < limit && address[shared] == (*previous)[shared])
+            {
+                ++shared;
+            }
+        }
+
+        data_ += static_cast<char>(shared);
+        data_ += static_cast<char>(address.size() - shared);
+        data_.append(address, shared, std::string::npos);
+
+        previous = &address;
+        ++size_;
+    }
+
+    data_.shrink_to_fit();
+}
+
+size_t blockparser::AddressIndex::decode(size_t offset, std::string& address) const
+{
+    auto const shared{static_cast<uint8_t>(data_[offset])};
+    auto const length{static_cast<uint8_t>(data_[offset + 1])};
+
+    address.resize(shared);
+    address.append(data_, offset + 2, length);
+    return offset + 2 + length;
+}
+
+size_t blockparser::AddressIndex::position(std::string const& prefix, bool upper) const
+{
+    auto const before = [&](char const* s, size_t length)
+    {
+        auto const cmp{compare(s, length, prefix)};
+        return upper ? cmp <= 0 : cmp < 0;
+    };
+
+    // the first bucket whose first address is not before the position; the position is in the bucket before
+    auto const bucket{std::partition_point(heads_.begin(), heads_.end(),
+                                           [&](uint32_t head)
+                                           {
+                                               return before(data_.data() + head + 2,
+                                                             static_cast<uint8_t>(data_[head + 1]));
+                                           }) -
+                      heads_.begin()};
+    if (bucket == 0) return 0;
+
+    auto position{(bucket - 1) * bucket_size};
+    std::string address;
+    for (auto offset{heads_[bucket - 1]}; position < std::min(size_, bucket * bucket_size); ++position)
+    {
+        offset = decode(offset, address);
+        if (!before(address.data(), address.size())) break;
+    }
+
+    return position;
+}
+
+size_t blockparser::AddressIndex::count(std::string const& prefix) const
+{
+    auto const key{fold(prefix)};
+    return position(key, true) - position(key, false);
+}
+
+std::vector<std::string> blockparser::AddressIndex::find(std::string const& prefix, size_t limit) const
+{
+    auto const key{fold(prefix)};
+    auto const first{position(key, false)};
+    auto const last{std::min(position(key, true), first + limit)};
+
+    std::vector<std::string> matches;
+    if (first >= last) return matches;
+
+    matches.reserve(last - first);
+
+    // decode from the start of the first match's bucket
+    std::string address;
+    size_t offset{heads_[first / bucket_size]};
+    for (auto i{first / bucket_size * bucket_size}; i < last; ++i)
+    {
+        offset = decode(offset, address);
+        if (i >= first)
+        {
+            matches.push_back(address);
+        }
+    }
+
+    return matches;
+}
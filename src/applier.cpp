@@ -0,0 +1,141 @@
+#include "applier.hpp"
+
+#include <algorithm>
+#include <optional>
+
+blockparser::BlockPtr blockparser::ChainApplier::read(BlockLocation const& location, size_t height)
+{
+    auto& stream{streams_.at(location.file)};
+    if (!stream.is_open())
+    {
+        stream.open(paths_.at(location.file), std::ios::in | std::ios::binary);
+    }
+
+    stream.clear();
+    stream.seekg(location.offset);
+
+    return std::make_shared<Block>(read_block(stream, location.size, height));
+}
+
+void blockparser::ChainApplier::park(size_t height, BlockLocation const& location)
+{
+    Parked parked{nullptr, location};
+
+    if (buffered_ + location.size <= budget_)
+    {
+        parked.block = read(location, height);
+        buffered_ += location.size;
+        peak_buffered_ = std::max(peak_buffered_, buffered_);
+    }
+    else
+    {
+        spilled_++;
+    }
+
+    parked_.emplace(height, std::move(parked));
+    peak_parked_ = std::max(peak_parked_, parked_.size());
+}
+
+void blockparser::ChainApplier::run(size_t from_height, apply_t const& apply)
+{
+    streams_ = std::vector<std::ifstream>(paths_.size());
+    parked_.clear();
+    buffered_ = 0;
+
+    // the order in which the main chain blocks are stored
+    std::vector<size_t> file_order;
+    for (auto height{from_height}; height < chain_.size(); ++height)
+    {
+        file_order.push_back(height);
+    }
+
+    std::sort(file_order.begin(), file_order.end(),
+              [this](size_t lhs, size_t rhs) { return chain_[lhs].location < chain_[rhs].location; });
+
+    auto next{from_height};
+
+    // the phases can only be followed from genesis
+    std::optional<SchemaPhase> phase{};
+    if (from_height == 0)
+    {
+        phase.emplace();
+    }
+
+    auto const apply_next = [&](BlockPtr const& block)
+    {
+        if (next > 0 && block->header().hash_previous_block_ != chain_[next - 1].hash)
+        {
+            throw ParseException{"Block at height " + std::to_string(next) + " does not extend " +
+                                 chain_[next - 1].hash.ToString()};
+        }
+
+        for (auto&& tx : block->transactions())
+        {
+            if (phase)
+            {
+                assert_schema_matches_assumption(tx, *phase);
+            }
+        }
+
+        apply(block, chain_[next], next);
+        next++;
+    };
+
+    for (auto height : file_order)
+    {
+        if (height != next)
+        {
+            park(height, chain_[height].location);
+            continue;
+        }
+
+        apply_next(read(chain_[height].location, height));
+
+        // the parent of parked blocks might just have been applied
+        for (auto it{parked_.find(next)}; it != parked_.end(); it = parked_.find(next))
+        {
+            auto block{std::move(it->second.block)};
+            if (block)
+            {
+                buffered_ -= it->second.location.size;
+            }
+            else
+            {
+                block = read(it->second.location, next);
+            }
+
+            parked_.erase(it);
+            apply_next(block);
+        }
+    }
+
+    if (next != chain_.size())
+    {
+        throw ParseException{"Stopped at height " + std::to_string(next) + " of " + std::to_string(chain_.size())};
+    }
+}
+
+void blockparser::ChainApplier::run(UtxoSet& utxos, Sink& sink)
+{
+    auto const from{sink.next_height()};
+
+    run(utxos.next_height(),
+        [&](auto const& block, auto const& entry, size_t height)
+        {
+            auto const delta{utxos.apply(*block, entry.hash, height)};
+            if (height < from) return;
+
+            sink.begin_block(*block, entry.hash, height);
+            for (auto&& [outpoint, coin] : delta.created)
+            {
+                sink.put_output(outpoint, coin);
+            }
+            for (auto&& [outpoint, coin] : delta.spent)
+            {
+                sink.spend(outpoint, coin);
+            }
+            sink.end_block(utxos);
+        });
+
+    sink.flush();
+}
@@ -32,7 +32,10 @@ blockparser::Block blockparser::read_block(std::ifstream& stream, uint32_t block
 
     for (size_t i{}; i < tx_count; ++i)
     {
+        auto const tx_offset{stream.tellg()};
         block.transactions_.emplace_back(read_transaction(stream));
+        block.transactions_.back().offset = static_cast<uint32_t>(tx_offset - block_offset);
+        block.transactions_.back().size   = static_cast<uint32_t>(stream.tellg() - tx_offset);
         // std::cout << "Read tx " << i << std::endl;
         // std::cout << block.transactions_.back() << std::endl;
     }
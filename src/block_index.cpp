@@ -0,0 +1,304 @@
+#include "block_index.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include <zenon/crypto/sha256.h>
+
+namespace
+{
+    // Index file layout: IndexFileHeader, IndexFileStamp[file_count], IndexFileEntry[entry_count] sorted by hash.
+    // The checksum is the SHA256 over the header (with the checksum zeroed), stamps and entries.
+    char constexpr index_magic[8]{'Z', 'N', 'N', 'B', 'I', 'D', 'X', '\0'};
+    uint32_t constexpr index_version{2};
+
+    struct IndexFileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t file_count;
+        uint64_t entry_count;
+        uint8_t checksum[32];
+    };
+
+    struct IndexFileStamp
+    {
+        uint64_t size;
+        int64_t mtime;
+    };
+
+    struct IndexFileEntry
+    {
+        uint8_t hash[32];
+        uint8_t prev[32];
+        uint64_t offset;
+        uint32_t file;
+        uint32_t size;
+        uint32_t time;
+        uint32_t bits;
+        int32_t version;
+        uint32_t tx_count;
+        uint32_t height;
+        uint32_t flags;
+    };
+
+    uint32_t constexpr flag_main_chain{1};
+
+    static_assert(sizeof(IndexFileHeader) == 56);
+    static_assert(sizeof(IndexFileStamp) == 16);
+    static_assert(sizeof(IndexFileEntry) == 104);
+} // namespace
+
+blockparser::FileStamp blockparser::file_stamp(std::string const& path)
+{
+    struct stat st
+    {
+    };
+
+    if (::stat(path.c_str(), &st) != 0)
+    {
+        return {};
+    }
+
+    return {static_cast<uint64_t>(st.st_size), static_cast<int64_t>(st.st_mtime)};
+}
+
+uint256 blockparser::block_work(uint32_t bits)
+{
+    bool negative{};
+    bool overflow{};
+
+    uint256 target;
+    target.SetCompact(bits, &negative, &overflow);
+
+    if (negative || overflow || target == 0)
+    {
+        return 0;
+    }
+
+    // 2^256 / (target + 1) can't be represented in 256 bits; it equals (~target / (target + 1)) + 1.
+    return (~target / (target + 1)) + 1;
+}
+
+bool blockparser::BlockIndex::add(uint256 const& hash, Header const& header, BlockLocation location,
+                                  uint32_t tx_count)
+{
+    auto [it, inserted]{entries_.try_emplace(hash)};
+    if (!inserted)
+    {
+        return false;
+    }
+
+    auto& entry{it->second};
+    entry.hash     = hash;
+    entry.header   = header;
+    entry.location = location;
+    entry.tx_count = tx_count;
+
+    return true;
+}
+
+void blockparser::BlockIndex::select_best_chain()
+{
+    std::unordered_map<uint256, std::vector<IndexEntry*>, detail::uint256_cheap_hash> children;
+    std::vector<IndexEntry*> pending;
+
+    for (auto&& [hash, entry] : entries_)
+    {
+        entry.prev       = nullptr;
+        entry.linked     = false;
+        entry.main_chain = false;
+
+        if (entry.header.hash_previous_block_.IsNull())
+        {
+            entry.height    = 0;
+            entry.chainwork = block_work(entry.header.bits_);
+            entry.linked    = true;
+            pending.push_back(&entry);
+        }
+        else
+        {
+            children[entry.header.hash_previous_block_].push_back(&entry);
+        }
+    }
+
+    tips_.clear();
+
+    // Depth first from genesis; every linked header is visited exactly once.
+    size_t linked{};
+    while (!pending.empty())
+    {
+        auto* entry{pending.back()};
+        pending.pop_back();
+        linked++;
+
+        auto it{children.find(entry->hash)};
+        if (it == children.end())
+        {
+            tips_.push_back(entry);
+            continue;
+        }
+
+        for (auto* child : it->second)
+        {
+            child->prev      = entry;
+            child->height    = entry->height + 1;
+            child->chainwork = entry->chainwork + block_work(child->header.bits_);
+            child->linked    = true;
+            pending.push_back(child);
+        }
+    }
+
+    unlinked_ = entries_.size() - linked;
+
+    std::sort(tips_.begin(), tips_.end(),
+              [](auto const* lhs, auto const* rhs)
+              {
+                  return lhs->chainwork > rhs->chainwork ||
+                         (lhs->chainwork == rhs->chainwork && lhs->location < rhs->location);
+              });
+
+    for (auto* entry{tip()}; entry; entry = entry->prev)
+    {
+        entries_.at(entry->hash).main_chain = true;
+    }
+}
+
+std::vector<blockparser::IndexEntry const*> blockparser::BlockIndex::main_chain() const
+{
+    std::vector<IndexEntry const*> chain(tip() ? tip()->height + 1 : 0);
+
+    for (auto* entry{tip()}; entry; entry = entry->prev)
+    {
+        chain[entry->height] = entry;
+    }
+
+    return chain;
+}
+
+void blockparser::BlockIndex::save(std::string const& path, std::vector<FileStamp> const& stamps) const
+{
+    std::vector<IndexFileStamp> file_stamps;
+    std::transform(stamps.begin(), stamps.end(), std::back_inserter(file_stamps),
+                   [](auto const& stamp) { return IndexFileStamp{stamp.size, stamp.mtime}; });
+
+    std::vector<IndexFileEntry> records;
+    records.reserve(entries_.size());
+
+    for (auto&& [hash, entry] : entries_)
+    {
+        IndexFileEntry record{};
+        std::memcpy(record.hash, hash.begin(), sizeof(record.hash));
+        std::memcpy(record.prev, entry.header.hash_previous_block_.begin(), sizeof(record.prev));
+        record.offset   = entry.location.offset;
+        record.file     = entry.location.file;
+        record.size     = entry.location.size;
+        record.time     = entry.header.time_;
+        record.bits     = entry.header.bits_;
+        record.version  = entry.header.version_;
+        record.tx_count = entry.tx_count;
+        record.height   = static_cast<uint32_t>(entry.height);
+        record.flags    = entry.main_chain ? flag_main_chain : 0;
+        records.push_back(record);
+    }
+
+    std::sort(records.begin(), records.end(),
+              [](auto const& lhs, auto const& rhs) { return std::memcmp(lhs.hash, rhs.hash, sizeof(lhs.hash)) < 0; });
+
+    IndexFileHeader header{};
+    std::memcpy(header.magic, index_magic, sizeof(index_magic));
+    header.version     = index_version;
+    header.file_count  = static_cast<uint32_t>(file_stamps.size());
+    header.entry_count = records.size();
+
+    CSHA256 hasher;
+    hasher.Write(reinterpret_cast<unsigned char const*>(&header), sizeof(header));
+    hasher.Write(reinterpret_cast<unsigned char const*>(file_stamps.data()),
+                 file_stamps.size() * sizeof(IndexFileStamp));
+    hasher.Write(reinterpret_cast<unsigned char const*>(records.data()), records.size() * sizeof(IndexFileEntry));
+    hasher.Finalize(header.checksum);
+
+    auto const tmp_path{path + ".tmp"};
+    std::ofstream file{tmp_path, std::ios::binary | std::ios::trunc};
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    file.write(reinterpret_cast<char const*>(file_stamps.data()), file_stamps.size() * sizeof(IndexFileStamp));
+    file.write(reinterpret_cast<char const*>(records.data()), records.size() * sizeof(IndexFileEntry));
+    file.close();
+
+    if (!file || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        std::cout << "Failed to write the block index to " << path << std::endl;
+    }
+}
+
+std::vector<bool> blockparser::BlockIndex::load(std::string const& path, std::vector<FileStamp> const& stamps)
+{
+    std::vector<bool> fresh(stamps.size(), false);
+
+    std::ifstream file{path, std::ios::binary | std::ios::ate};
+    if (!file)
+    {
+        return fresh;
+    }
+
+    auto const size{static_cast<size_t>(file.tellg())};
+    file.seekg(0);
+
+    IndexFileHeader header{};
+    if (size < sizeof(header) || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, index_magic, sizeof(index_magic)) || header.version != index_version ||
+        size != sizeof(header) + header.file_count * sizeof(IndexFileStamp) +
+                    header.entry_count * sizeof(IndexFileEntry))
+    {
+        std::cout << "Ignoring invalid block index " << path << std::endl;
+        return fresh;
+    }
+
+    std::vector<IndexFileStamp> file_stamps(header.file_count);
+    std::vector<IndexFileEntry> records(header.entry_count);
+    file.read(reinterpret_cast<char*>(file_stamps.data()), file_stamps.size() * sizeof(IndexFileStamp));
+    file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(IndexFileEntry));
+
+    auto unchecked{header};
+    std::memset(unchecked.checksum, 0, sizeof(unchecked.checksum));
+
+    uint8_t checksum[CSHA256::OUTPUT_SIZE];
+    CSHA256 hasher;
+    hasher.Write(reinterpret_cast<unsigned char const*>(&unchecked), sizeof(unchecked));
+    hasher.Write(reinterpret_cast<unsigned char const*>(file_stamps.data()),
+                 file_stamps.size() * sizeof(IndexFileStamp));
+    hasher.Write(reinterpret_cast<unsigned char const*>(records.data()), records.size() * sizeof(IndexFileEntry));
+    hasher.Finalize(checksum);
+
+    if (!file || std::memcmp(checksum, header.checksum, sizeof(checksum)))
+    {
+        std::cout << "Ignoring corrupt block index " << path << std::endl;
+        return fresh;
+    }
+
+    for (size_t i{}; i < stamps.size() && i < file_stamps.size(); ++i)
+    {
+        fresh[i] = stamps[i] == FileStamp{file_stamps[i].size, file_stamps[i].mtime};
+    }
+
+    for (auto&& record : records)
+    {
+        if (record.file >= fresh.size() || !fresh[record.file]) continue;
+
+        uint256 hash;
+        std::memcpy(hash.begin(), record.hash, sizeof(record.hash));
+
+        Header entry_header;
+        std::memcpy(entry_header.hash_previous_block_.begin(), record.prev, sizeof(record.prev));
+        entry_header.version_ = record.version;
+        entry_header.time_    = record.time;
+        entry_header.bits_    = record.bits;
+
+        add(hash, entry_header, {record.file, record.offset, record.size}, record.tx_count);
+    }
+
+    return fresh;
+}
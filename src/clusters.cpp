@@ -0,0 +1,137 @@
+#include "clusters.hpp"
+
+#include "union_find.hpp"
+
+#include <algorithm>
+#include <thread>
+
+void blockparser::ClusterSink::begin_block(Block const& block, uint256 const&, size_t height)
+{
+    claiming_.clear();
+    first_.clear();
+    claimed_ = 0;
+    height_  = height;
+
+    if (height > options_.height) return;
+
+    for (auto&& tx : block.transactions())
+    {
+        for (auto&& vin : tx.vin)
+        {
+            if (claims_output(vin))
+            {
+                claiming_.push_back(first_.size());
+            }
+        }
+
+        first_.emplace_back();
+    }
+}
+
+void blockparser::ClusterSink::spend(OutPoint const&, Coin const& coin)
+{
+    if (height_ > options_.height) return;
+
+    auto& first{first_.at(claiming_.at(claimed_++))};
+    if (coin.address.empty()) return;
+
+    auto const id{addresses_.insert(coin.address).first};
+    if (!first)
+    {
+        first = id;
+    }
+    else if (*first != id)
+    {
+        edges_.emplace_back(*first, id);
+    }
+}
+
+void blockparser::ClusterSink::end_block(UtxoSet const& utxos)
+{
+    if (height_ > options_.height) return;
+
+    utxos_ = &utxos;
+    if (height_ == options_.height)
+    {
+        take_balances(utxos);
+    }
+}
+
+void blockparser::ClusterSink::take_balances(UtxoSet const& utxos)
+{
+    for (auto&& [address, balance] : utxos.balances())
+    {
+        auto const id{addresses_.insert(address).first};
+        balances_.resize(std::max(balances_.size(), size_t{id} + 1));
+        balances_[id] = balance;
+    }
+
+    balance_height_ = utxos.next_height() - 1;
+}
+
+void blockparser::ClusterSink::flush()
+{
+    // the tip, if the chain ends below height
+    if (!balance_height_ && utxos_)
+    {
+        take_balances(*utxos_);
+    }
+    utxos_ = nullptr;
+
+    balances_.resize(addresses_.size());
+    ConcurrentUnionFind sets{addresses_.size()};
+
+    // every thread unites a contiguous slice of the edges
+    auto const threads{std::max(size_t{1}, options_.threads)};
+    auto const slice{(edges_.size() + threads - 1) / threads};
+
+    std::vector<std::thread> workers;
+    for (size_t t{}; t < threads && t * slice < edges_.size(); ++t)
+    {
+        workers.emplace_back(
+            [&, t]
+            {
+                for (auto i{t * slice}; i < std::min(edges_.size(), (t + 1) * slice); ++i)
+                {
+                    sets.unite(edges_[i].first, edges_[i].second);
+                }
+            });
+    }
+
+    for (auto&& worker : workers)
+    {
+        worker.join();
+    }
+
+    edges_.clear();
+    edges_.shrink_to_fit();
+
+    // roots are the smallest ids of their sets, so each cluster is complete once its root has been seen
+    cluster_ids_.resize(addresses_.size());
+    std::vector<uint32_t> index(addresses_.size()); // of the cluster in clusters_, by root
+    clusters_.clear();
+
+    for (uint32_t id{}; id < addresses_.size(); ++id)
+    {
+        auto const root{sets.find(id)};
+        cluster_ids_[id] = root;
+
+        if (root == id)
+        {
+            index[id] = static_cast<uint32_t>(clusters_.size());
+            clusters_.push_back({id, 0, 0});
+        }
+
+        auto& cluster{clusters_[index[root]]};
+        ++cluster.size;
+        cluster.balance += balances_[id];
+    }
+
+    std::sort(clusters_.begin(), clusters_.end(),
+              [](Cluster const& lhs, Cluster const& rhs)
+              {
+                  return lhs.balance != rhs.balance ? lhs.balance > rhs.balance
+                         : lhs.size != rhs.size     ? lhs.size > rhs.size
+                                                    : lhs.id < rhs.id;
+              });
+}
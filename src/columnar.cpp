@@ -0,0 +1,348 @@
+#include "columnar.hpp"
+
+#ifdef WITH_ARROW
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/writer.h>
+#include <parquet/arrow/writer.h>
+#include <sys/stat.h>
+
+namespace
+{
+    void check(arrow::Status const& status)
+    {
+        if (!status.ok())
+        {
+            throw blockparser::ColumnarException{status.ToString()};
+        }
+    }
+
+    template <typename T> T check(arrow::Result<T> result)
+    {
+        check(result.status());
+        return std::move(result).ValueUnsafe();
+    }
+
+    char const* script_name(blockparser::script_t type)
+    {
+        switch (type)
+        {
+        case blockparser::script_t::PKH: return "pkh";
+        case blockparser::script_t::PK: return "pk";
+        case blockparser::script_t::P2SH: return "p2sh";
+        case blockparser::script_t::DATA: return "data";
+        case blockparser::script_t::PUZZLE: return "puzzle";
+        case blockparser::script_t::EMPTY: return "empty";
+        case blockparser::script_t::ZEROCOINMINT: return "zerocoin_mint";
+        case blockparser::script_t::NONSTANDARD: return "nonstandard";
+        }
+        return "unknown";
+    }
+
+    std::shared_ptr<arrow::Field> required(std::string name, std::shared_ptr<arrow::DataType> type)
+    {
+        return arrow::field(std::move(name), std::move(type), false);
+    }
+
+    std::shared_ptr<arrow::Field> nullable(std::string name, std::shared_ptr<arrow::DataType> type)
+    {
+        return arrow::field(std::move(name), std::move(type), true);
+    }
+
+    auto const blocks_schema{
+        arrow::schema({required("height", arrow::uint32()), required("hash", arrow::utf8()),
+                       required("previous", arrow::utf8()), required("merkle_root", arrow::utf8()),
+                       required("version", arrow::int32()), required("time", arrow::uint32()),
+                       required("bits", arrow::uint32()), required("nonce", arrow::uint32()),
+                       required("size", arrow::uint32()), required("txs", arrow::uint32())})};
+
+    auto const txs_schema{
+        arrow::schema({required("height", arrow::uint32()), required("position", arrow::uint32()),
+                       required("txid", arrow::utf8()), required("version", arrow::int32()),
+                       required("locktime", arrow::uint32()), required("size", arrow::uint32()),
+                       required("inputs", arrow::uint32()), required("outputs", arrow::uint32())})};
+
+    auto const vin_schema{
+        arrow::schema({required("height", arrow::uint32()), required("txid", arrow::utf8()),
+                       required("index", arrow::uint32()), nullable("prev_txid", arrow::utf8()),
+                       nullable("prev_index", arrow::uint32()), required("sequence", arrow::uint32()),
+                       nullable("address", arrow::utf8()), nullable("amount", arrow::int64())})};
+
+    auto const vout_schema{
+        arrow::schema({required("height", arrow::uint32()), required("txid", arrow::utf8()),
+                       required("index", arrow::uint32()), nullable("address", arrow::utf8()),
+                       required("amount", arrow::int64()), required("script_type", arrow::utf8())})};
+
+    // Column builders of a table, appended to row by row.
+    class TableBuilder
+    {
+    public:
+        explicit TableBuilder(std::shared_ptr<arrow::Schema> schema) : schema_{std::move(schema)}
+        {
+            builder_ = check(arrow::RecordBatchBuilder::Make(schema_, arrow::default_memory_pool()));
+        }
+
+        template <typename Builder> Builder& column(int i) { return *builder_->GetFieldAs<Builder>(i); }
+
+        void append(int i, uint32_t value) { check(column<arrow::UInt32Builder>(i).Append(value)); }
+        void append(int i, int32_t value) { check(column<arrow::Int32Builder>(i).Append(value)); }
+        void append(int i, int64_t value) { check(column<arrow::Int64Builder>(i).Append(value)); }
+        void append(int i, std::string const& value) { check(column<arrow::StringBuilder>(i).Append(value)); }
+        void append_null(int i) { check(builder_->GetField(i)->AppendNull()); }
+
+        std::shared_ptr<arrow::RecordBatch> finish() { return check(builder_->Flush()); }
+
+    private:
+        std::shared_ptr<arrow::Schema> schema_;
+        std::unique_ptr<arrow::RecordBatchBuilder> builder_{};
+    };
+
+    // A file of one table, in either format.
+    class TableWriter
+    {
+    public:
+        TableWriter(std::string const& path, std::shared_ptr<arrow::Schema> const& schema,
+                    blockparser::ColumnarSink::Format format)
+        {
+            auto const file{check(arrow::io::FileOutputStream::Open(path))};
+
+            if (format == blockparser::ColumnarSink::Format::parquet)
+            {
+                parquet_ = check(parquet::arrow::FileWriter::Open(*schema, arrow::default_memory_pool(), file));
+            }
+            else
+            {
+                ipc_ = check(arrow::ipc::MakeFileWriter(file, schema));
+            }
+        }
+
+        // a row group per batch
+        void write(std::shared_ptr<arrow::RecordBatch> const& batch)
+        {
+            if (!batch->num_rows()) return;
+
+            if (parquet_)
+            {
+                auto const table{check(arrow::Table::FromRecordBatches({batch}))};
+                check(parquet_->WriteTable(*table, batch->num_rows()));
+            }
+            else
+            {
+                check(ipc_->WriteRecordBatch(*batch));
+            }
+        }
+
+        void close() { check(parquet_ ? parquet_->Close() : ipc_->Close()); }
+
+    private:
+        std::unique_ptr<parquet::arrow::FileWriter> parquet_{};
+        std::shared_ptr<arrow::ipc::RecordBatchWriter> ipc_{};
+    };
+} // namespace
+
+struct blockparser::ColumnarSink::RowGroup
+{
+    std::shared_ptr<arrow::RecordBatch> blocks{};
+    std::shared_ptr<arrow::RecordBatch> txs{};
+    std::shared_ptr<arrow::RecordBatch> vin{};
+    std::shared_ptr<arrow::RecordBatch> vout{};
+};
+
+struct blockparser::ColumnarSink::Writers
+{
+    TableWriter blocks;
+    TableWriter txs;
+    TableWriter vin;
+    TableWriter vout;
+};
+
+blockparser::ColumnarSink::ColumnarSink(Options options) : options_{std::move(options)}
+{
+    ::mkdir(options_.directory.c_str(), 0755);
+
+    auto const path = [&](std::string const& table)
+    { return options_.directory + "/" + table + (options_.format == Format::parquet ? ".parquet" : ".arrow"); };
+
+    writers_.reset(new Writers{{path("blocks"), blocks_schema, options_.format},
+                               {path("txs"), txs_schema, options_.format},
+                               {path("vin"), vin_schema, options_.format},
+                               {path("vout"), vout_schema, options_.format}});
+}
+
+// the futures of std::async wait for pending row groups
+blockparser::ColumnarSink::~ColumnarSink() = default;
+
+std::shared_ptr<blockparser::ColumnarSink::RowGroup> blockparser::ColumnarSink::build(std::vector<Item> items)
+{
+    TableBuilder blocks{blocks_schema};
+    TableBuilder txs{txs_schema};
+    TableBuilder vin{vin_schema};
+    TableBuilder vout{vout_schema};
+
+    for (auto&& item : items)
+    {
+        auto const height{static_cast<uint32_t>(item.height)};
+        auto const& header{item.block.header()};
+        auto const& transactions{item.block.transactions()};
+
+        blocks.append(0, height);
+        blocks.append(1, item.hash.ToString());
+        blocks.append(2, header.hash_previous_block_.ToString());
+        blocks.append(3, header.hash_merkle_root_.ToString());
+        blocks.append(4, header.version_);
+        blocks.append(5, header.time_);
+        blocks.append(6, header.bits_);
+        blocks.append(7, header.nonce_);
+        blocks.append(8, item.block.size());
+        blocks.append(9, static_cast<uint32_t>(transactions.size()));
+
+        // the block's spent outputs are in the order of the inputs claiming them
+        auto spent{item.spent.begin()};
+
+        for (size_t position{}; position < transactions.size(); ++position)
+        {
+            auto const& tx{transactions[position]};
+            auto const txid{tx.hash.ToString()};
+
+            txs.append(0, height);
+            txs.append(1, static_cast<uint32_t>(position));
+            txs.append(2, txid);
+            txs.append(3, tx.version);
+            txs.append(4, tx.locktime);
+            txs.append(5, tx.size);
+            txs.append(6, static_cast<uint32_t>(tx.vin.size()));
+            txs.append(7, static_cast<uint32_t>(tx.vout.size()));
+
+            for (size_t i{}; i < tx.vin.size(); ++i)
+            {
+                auto const& input{tx.vin[i]};
+
+                vin.append(0, height);
+                vin.append(1, txid);
+                vin.append(2, static_cast<uint32_t>(i));
+                vin.append(5, input.sequence);
+
+                if (claims_output(input) && spent != item.spent.end())
+                {
+                    auto const& [outpoint, coin]{*spent++};
+                    vin.append(3, outpoint.hash.ToString());
+                    vin.append(4, outpoint.index);
+                    coin.address.empty() ? vin.append_null(6) : vin.append(6, coin.address);
+                    vin.append(7, coin.amount);
+                }
+                else
+                {
+                    vin.append_null(3);
+                    vin.append_null(4);
+                    vin.append_null(6);
+                    vin.append_null(7);
+                }
+            }
+
+            for (size_t i{}; i < tx.vout.size(); ++i)
+            {
+                auto const& output{tx.vout[i]};
+
+                vout.append(0, height);
+                vout.append(1, txid);
+                vout.append(2, static_cast<uint32_t>(i));
+                output.address.empty() ? vout.append_null(3) : vout.append(3, output.address);
+                vout.append(4, output.amount);
+                vout.append(5, std::string{script_name(output.type)});
+            }
+        }
+    }
+
+    return std::make_shared<RowGroup>(RowGroup{blocks.finish(), txs.finish(), vin.finish(), vout.finish()});
+}
+
+void blockparser::ColumnarSink::begin_block(Block const& block, uint256 const& hash, size_t height)
+{
+    items_.push_back({block, hash, height, {}});
+}
+
+void blockparser::ColumnarSink::spend(OutPoint const& outpoint, Coin const& coin)
+{
+    items_.back().spent.emplace_back(outpoint, coin);
+}
+
+void blockparser::ColumnarSink::end_block(UtxoSet const&)
+{
+    if (items_.size() >= options_.row_group_blocks)
+    {
+        submit();
+    }
+}
+
+void blockparser::ColumnarSink::submit()
+{
+    if (items_.empty()) return;
+
+    // bound the row groups held in memory
+    while (building_.size() >= std::max(size_t{1}, options_.threads))
+    {
+        write_front();
+    }
+
+    building_.push_back(std::async(std::launch::async, &ColumnarSink::build, std::move(items_)));
+    items_ = {};
+}
+
+void blockparser::ColumnarSink::write_front()
+{
+    auto const group{building_.front().get()};
+    building_.pop_front();
+
+    writers_->blocks.write(group->blocks);
+    writers_->txs.write(group->txs);
+    writers_->vin.write(group->vin);
+    writers_->vout.write(group->vout);
+
+    rows_ += group->blocks->num_rows() + group->txs->num_rows() + group->vin->num_rows() + group->vout->num_rows();
+}
+
+void blockparser::ColumnarSink::flush()
+{
+    submit();
+    while (!building_.empty())
+    {
+        write_front();
+    }
+
+    writers_->blocks.close();
+    writers_->txs.close();
+    writers_->vin.close();
+    writers_->vout.close();
+}
+
+#else
+
+struct blockparser::ColumnarSink::RowGroup
+{
+};
+
+struct blockparser::ColumnarSink::Writers
+{
+};
+
+blockparser::ColumnarSink::ColumnarSink(Options options) : options_{std::move(options)}
+{
+    throw ColumnarException{"block-parser was built without Arrow support"};
+}
+
+blockparser::ColumnarSink::~ColumnarSink() = default;
+
+std::shared_ptr<blockparser::ColumnarSink::RowGroup> blockparser::ColumnarSink::build(std::vector<Item>)
+{
+    return {};
+}
+
+void blockparser::ColumnarSink::begin_block(Block const&, uint256 const&, size_t) {}
+void blockparser::ColumnarSink::spend(OutPoint const&, Coin const&) {}
+void blockparser::ColumnarSink::end_block(UtxoSet const&) {}
+void blockparser::ColumnarSink::submit() {}
+void blockparser::ColumnarSink::write_front() {}
+void blockparser::ColumnarSink::flush() {}
+
+#endif
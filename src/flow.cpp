@@ -0,0 +1,158 @@
+#include "flow.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <utility>
+
+namespace
+{
+    double constexpr satoshis_per_coin{100000000.0};
+    double constexpr seconds_per_day{86400.0};
+} // namespace
+
+blockparser::FlowSink::FlowSink(std::string const& path, Format format)
+    : path_{path}, format_{format}, file_{path, std::ios::binary | std::ios::trunc}
+{
+    if (!file_)
+    {
+        throw FlowException{"Can't create " + path};
+    }
+
+    if (format_ == Format::binary)
+    {
+        flow::FlowHeader header{};
+        std::memcpy(header.magic, flow::magic, sizeof(header.magic));
+        header.version     = flow::version;
+        header.record_size = sizeof(flow::FlowRecord);
+        file_.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    }
+    else
+    {
+        file_ << "height,time,txs,inputs,outputs,spent,volume,unspent,velocity,cdd,mean_age,median_age,max_age\n"
+              << std::setprecision(10);
+    }
+}
+
+void blockparser::FlowSink::begin_block(Block const& block, uint256 const&, size_t height)
+{
+    pending_.clear();
+    claiming_.clear();
+    ages_.clear();
+    claimed_ = 0;
+    height_  = height;
+
+    record_      = {};
+    record_.time = block.header().time_;
+    record_.txs  = static_cast<uint32_t>(block.transactions().size());
+
+    times_.resize(std::max(times_.size(), height + 1));
+    times_[height] = record_.time;
+
+    for (auto&& tx : block.transactions())
+    {
+        Pending pending;
+        for (auto&& vin : tx.vin)
+        {
+            if (claims_output(vin))
+            {
+                claiming_.push_back(pending_.size());
+            }
+        }
+
+        for (auto&& vout : tx.vout)
+        {
+            pending.outputs.push_back(&vout);
+        }
+
+        // as in SupplySink: a coinbase claims nothing, an extended pos coinbase claims the stake
+        pending.minting = is_pos_coinbase_ext(tx) ||
+                          std::all_of(tx.vin.begin(), tx.vin.end(),
+                                      [](auto const& vin) { return is_coinbase_input(vin); });
+
+        pending_.push_back(std::move(pending));
+    }
+}
+
+void blockparser::FlowSink::put_output(OutPoint const&, Coin const& coin)
+{
+    ++record_.outputs;
+    unspent_ += coin.amount;
+}
+
+void blockparser::FlowSink::spend(OutPoint const&, Coin const& coin)
+{
+    auto& pending{pending_.at(claiming_.at(claimed_++))};
+    if (!coin.address.empty())
+    {
+        pending.senders.push_back(coin.address);
+    }
+
+    auto const created{times_.at(coin.height)};
+    auto const seconds{record_.time > created ? record_.time - created : 0};
+    record_.cdd += coin.amount / satoshis_per_coin * (seconds / seconds_per_day);
+
+    ++record_.inputs;
+    record_.spent += coin.amount;
+    unspent_ -= coin.amount;
+    ages_.push_back(static_cast<uint32_t>(height_ - coin.height));
+}
+
+void blockparser::FlowSink::end_block(UtxoSet const&)
+{
+    for (auto&& pending : pending_)
+    {
+        if (pending.minting) continue;
+
+        std::sort(pending.senders.begin(), pending.senders.end());
+        for (auto&& vout : pending.outputs)
+        {
+            if (!std::binary_search(pending.senders.begin(), pending.senders.end(), vout->address))
+            {
+                record_.volume += vout->amount;
+            }
+        }
+    }
+
+    if (!ages_.empty())
+    {
+        uint64_t sum{};
+        for (auto age : ages_)
+        {
+            sum += age;
+        }
+
+        auto const middle{ages_.begin() + ages_.size() / 2};
+        std::nth_element(ages_.begin(), middle, ages_.end());
+
+        record_.mean_age   = static_cast<uint32_t>(sum / ages_.size());
+        record_.median_age = *middle;
+        record_.max_age    = *std::max_element(ages_.begin(), ages_.end());
+    }
+
+    record_.unspent = unspent_;
+    cdd_ += record_.cdd;
+    volume_ += record_.volume;
+
+    if (format_ == Format::binary)
+    {
+        file_.write(reinterpret_cast<char const*>(&record_), sizeof(record_));
+    }
+    else
+    {
+        auto const velocity{unspent_ > 0 ? static_cast<double>(record_.volume) / unspent_ : 0.0};
+        file_ << height_ << ',' << record_.time << ',' << record_.txs << ',' << record_.inputs << ','
+              << record_.outputs << ',' << record_.spent << ',' << record_.volume << ',' << record_.unspent << ','
+              << velocity << ',' << record_.cdd << ',' << record_.mean_age << ',' << record_.median_age << ','
+              << record_.max_age << '\n';
+    }
+}
+
+void blockparser::FlowSink::flush()
+{
+    file_.flush();
+    if (!file_)
+    {
+        throw FlowException{"Failed to write " + path_};
+    }
+}
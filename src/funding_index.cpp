@@ -0,0 +1,188 @@
+#include "funding_index.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+    // Sort by address and sum the amounts of equal addresses.
+    template <typename T> void merge(std::vector<T>& entries)
+    {
+        std::sort(entries.begin(), entries.end(),
+                  [](auto const& lhs, auto const& rhs) { return lhs.address < rhs.address; });
+
+        auto out{entries.begin()};
+        for (auto it{entries.begin()}; it != entries.end(); ++it)
+        {
+            if (out != entries.begin() && std::prev(out)->address == it->address)
+            {
+                std::prev(out)->amount += it->amount;
+            }
+            else
+            {
+                *out++ = *it;
+            }
+        }
+        entries.erase(out, entries.end());
+    }
+} // namespace
+
+uint32_t blockparser::FundingIndex::id(std::string const& address)
+{
+    auto const [id, seen]{addresses_.insert(address)};
+    if (!seen)
+    {
+        received_.emplace_back();
+    }
+    return id;
+}
+
+void blockparser::FundingIndex::begin_block(Block const& block, uint256 const&, size_t height)
+{
+    pending_.clear();
+    claiming_.clear();
+    claimed_ = 0;
+    height_  = static_cast<uint32_t>(height);
+
+    for (auto&& tx : block.transactions())
+    {
+        // as in SupplySink: a coinbase claims nothing, an extended pos coinbase claims the stake
+        Pending pending{tx.hash,
+                        is_pos_coinbase_ext(tx) ||
+                            std::all_of(tx.vin.begin(), tx.vin.end(),
+                                        [](auto const& vin) { return is_coinbase_input(vin); }),
+                        {},
+                        {}};
+        for (auto&& vout : tx.vout)
+        {
+            if (!vout.address.empty())
+            {
+                pending.outputs.push_back({id(vout.address), vout.amount});
+            }
+        }
+
+        for (auto&& vin : tx.vin)
+        {
+            if (claims_output(vin))
+            {
+                claiming_.push_back(pending_.size());
+            }
+        }
+
+        pending_.push_back(std::move(pending));
+    }
+}
+
+void blockparser::FundingIndex::spend(OutPoint const&, Coin const& coin)
+{
+    auto& pending{pending_.at(claiming_.at(claimed_++))};
+    if (!coin.address.empty())
+    {
+        pending.inputs.push_back({id(coin.address), coin.amount});
+    }
+}
+
+void blockparser::FundingIndex::end_block(UtxoSet const&)
+{
+    for (auto&& pending : pending_)
+    {
+        if (pending.minting || pending.inputs.empty()) continue;
+
+        merge(pending.inputs);
+        merge(pending.outputs);
+
+        // change back to a sender is no funding
+        pending.outputs.erase(std::remove_if(pending.outputs.begin(), pending.outputs.end(),
+                                             [&](Input const& output)
+                                             {
+                                                 return std::binary_search(
+                                                     pending.inputs.begin(), pending.inputs.end(), output,
+                                                     [](Input const& lhs, Input const& rhs)
+                                                     { return lhs.address < rhs.address; });
+                                             }),
+                              pending.outputs.end());
+        if (pending.outputs.empty()) continue;
+
+        auto const tx{static_cast<uint32_t>(txids_.size())};
+        txids_.push_back(pending.txid);
+        heights_.push_back(height_);
+        inputs_.insert(inputs_.end(), pending.inputs.begin(), pending.inputs.end());
+        input_offsets_.push_back(inputs_.size());
+
+        for (auto&& output : pending.outputs)
+        {
+            received_[output.address].push_back({tx, output.amount});
+        }
+    }
+}
+
+std::vector<blockparser::FundingIndex::Funding> blockparser::FundingIndex::fundings(std::string const& address) const
+{
+    std::vector<Funding> fundings;
+
+    if (auto const id{addresses_.find(address)})
+    {
+        for (auto&& received : received_[*id])
+        {
+            fundings.push_back({txids_[received.tx], heights_[received.tx], received.amount});
+        }
+    }
+
+    return fundings;
+}
+
+std::vector<blockparser::FundingIndex::Sender>
+blockparser::FundingIndex::senders(std::vector<std::string> const& addresses) const
+{
+    // what all addresses received per funding tx
+    std::vector<Received> received;
+    for (auto&& address : addresses)
+    {
+        if (auto const id{addresses_.find(address)})
+        {
+            received.insert(received.end(), received_[*id].begin(), received_[*id].end());
+        }
+    }
+
+    std::sort(received.begin(), received.end(), [](auto const& lhs, auto const& rhs) { return lhs.tx < rhs.tx; });
+
+    std::unordered_map<uint32_t, Sender> senders;
+    for (auto it{received.begin()}; it != received.end();)
+    {
+        auto const tx{it->tx};
+        int64_t amount{};
+        for (; it != received.end() && it->tx == tx; ++it)
+        {
+            amount += it->amount;
+        }
+
+        auto const first{inputs_.begin() + static_cast<ptrdiff_t>(input_offsets_[tx])};
+        auto const last{inputs_.begin() + static_cast<ptrdiff_t>(input_offsets_[tx + 1])};
+
+        __int128 total{};
+        for (auto input{first}; input != last; ++input)
+        {
+            total += input->amount;
+        }
+
+        for (auto input{first}; input != last; ++input)
+        {
+            auto& sender{senders[input->address]};
+            sender.amount += total ? static_cast<int64_t>(amount * static_cast<__int128>(input->amount) / total) : 0;
+            ++sender.txs;
+        }
+    }
+
+    std::vector<Sender> sorted;
+    sorted.reserve(senders.size());
+    for (auto&& [id, sender] : senders)
+    {
+        sender.address = addresses_.address(id);
+        sorted.push_back(std::move(sender));
+    }
+
+    std::sort(sorted.begin(), sorted.end(),
+              [](auto const& lhs, auto const& rhs)
+              { return lhs.amount != rhs.amount ? lhs.amount > rhs.amount : lhs.address < rhs.address; });
+    return sorted;
+}
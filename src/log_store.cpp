@@ -0,0 +1,290 @@
+#include "log_store.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zenon/crypto/sha256.h>
+
+using namespace blockparser::logstore;
+
+namespace
+{
+    void copy_address(char (&field)[address_size], std::string const& address)
+    {
+        if (address.size() > address_size)
+        {
+            throw blockparser::LogStoreException{"Address too long: " + address};
+        }
+
+        std::memset(field, 0, address_size);
+        std::memcpy(field, address.data(), address.size());
+    }
+
+    LogRecord outpoint_record(RecordType type, blockparser::OutPoint const& outpoint, blockparser::Coin const& coin,
+                              uint32_t height)
+    {
+        LogRecord record{};
+        record.type   = type;
+        record.height = height;
+        std::memcpy(record.hash, outpoint.hash.begin(), sizeof(record.hash));
+        record.index  = outpoint.index;
+        record.amount = coin.amount;
+        record.link   = no_record;
+        copy_address(record.address, coin.address);
+        return record;
+    }
+
+    blockparser::OutPoint outpoint(LogRecord const& record)
+    {
+        blockparser::OutPoint outpoint{{}, record.index};
+        std::memcpy(outpoint.hash.begin(), record.hash, sizeof(record.hash));
+        return outpoint;
+    }
+
+    // the first 8 bytes of the SHA256 over the records of a block
+    uint64_t checksum(LogRecord const* records, size_t count)
+    {
+        uint8_t hash[CSHA256::OUTPUT_SIZE];
+        CSHA256{}.Write(reinterpret_cast<unsigned char const*>(records), count * sizeof(LogRecord)).Finalize(hash);
+
+        uint64_t checksum{};
+        std::memcpy(&checksum, hash, sizeof(checksum));
+        return checksum;
+    }
+} // namespace
+
+blockparser::MappedLog::MappedLog(std::string const& path)
+{
+    auto const fd{::open(path.c_str(), O_RDONLY)};
+    if (fd < 0)
+    {
+        throw LogStoreException{"Can't open " + path};
+    }
+
+    struct stat st
+    {
+    };
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(LogHeader))
+    {
+        ::close(fd);
+        throw LogStoreException{path + " is too small to be a chain log"};
+    }
+
+    size_ = st.st_size;
+    data_ = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (data_ == MAP_FAILED)
+    {
+        data_ = nullptr;
+        throw LogStoreException{"Can't map " + path};
+    }
+
+    auto const bytes{static_cast<uint8_t const*>(data_)};
+    auto const* const header{reinterpret_cast<LogHeader const*>(bytes)};
+    records_begin_ = reinterpret_cast<LogRecord const*>(bytes + sizeof(LogHeader));
+
+    if (std::memcmp(header->magic, magic, sizeof(magic)) || header->version != version ||
+        header->record_size != sizeof(LogRecord))
+    {
+        ::munmap(data_, size_);
+        data_ = nullptr;
+        throw LogStoreException{path + " is not a chain log of version " + std::to_string(version)};
+    }
+
+    ::madvise(data_, size_, MADV_SEQUENTIAL);
+
+    // index block by block; a trailing block without valid block record was not completely written
+    auto const available{(size_ - sizeof(LogHeader)) / sizeof(LogRecord)};
+    for (uint64_t first{}, i{}; i < available; ++i)
+    {
+        auto const& record{records_begin_[i]};
+        if (record.type != logstore::block) continue;
+
+        if (record.height != blocks_.size() || record.link != checksum(records_begin_ + first, i - first)) break;
+
+        index(first, i);
+        first    = i + 1;
+        records_ = first;
+    }
+
+    ::madvise(data_, size_, MADV_RANDOM);
+}
+
+blockparser::MappedLog::~MappedLog()
+{
+    if (data_)
+    {
+        ::munmap(data_, size_);
+    }
+}
+
+void blockparser::MappedLog::index(uint64_t first, uint64_t last)
+{
+    for (auto i{first}; i < last; ++i)
+    {
+        auto const& record{records_begin_[i]};
+        switch (record.type)
+        {
+        case logstore::output: outputs_[outpoint(record)].created = i; break;
+        case logstore::spend: outputs_[outpoint(record)].spent = i; break;
+        case logstore::balance: addresses_[logstore::address(record.address)] = i; break;
+        }
+    }
+
+    blocks_.push_back(last);
+}
+
+uint256 blockparser::MappedLog::tip() const
+{
+    uint256 tip;
+    if (!blocks_.empty())
+    {
+        std::memcpy(tip.begin(), records_begin_[blocks_.back()].hash, sizeof(LogRecord::hash));
+    }
+    return tip;
+}
+
+LogRecord const* blockparser::MappedLog::output(OutPoint const& outpoint) const
+{
+    auto const it{outputs_.find(outpoint)};
+    return it == outputs_.end() || it->second.created == no_record ? nullptr : &records_begin_[it->second.created];
+}
+
+LogRecord const* blockparser::MappedLog::spend(OutPoint const& outpoint) const
+{
+    auto const it{outputs_.find(outpoint)};
+    return it == outputs_.end() || it->second.spent == no_record ? nullptr : &records_begin_[it->second.spent];
+}
+
+std::optional<int64_t> blockparser::MappedLog::balance(std::string const& address, size_t height) const
+{
+    auto const it{addresses_.find(address)};
+    if (it == addresses_.end()) return std::nullopt;
+
+    // the balance records of an address are linked from the latest backwards
+    for (auto i{it->second}; i != no_record; i = records_begin_[i].link)
+    {
+        if (records_begin_[i].height <= height)
+        {
+            return records_begin_[i].amount;
+        }
+    }
+
+    return std::nullopt;
+}
+
+blockparser::LogSink::LogSink(std::string path) : path_{std::move(path)}
+{
+    if (struct stat st{}; ::stat(path_.c_str(), &st) == 0)
+    {
+        {
+            MappedLog const log{path_};
+            records_      = log.records();
+            next_height_  = log.next_height();
+            tip_          = log.tip();
+            last_balance_ = log.addresses();
+        }
+
+        // drop the records of a block that was not completely written
+        if (::truncate(path_.c_str(), static_cast<off_t>(sizeof(LogHeader) + records_ * sizeof(LogRecord))) != 0)
+        {
+            throw LogStoreException{"Can't truncate " + path_};
+        }
+
+        file_.open(path_, std::ios::binary | std::ios::app);
+    }
+    else
+    {
+        LogHeader header{};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version     = version;
+        header.record_size = sizeof(LogRecord);
+
+        file_.open(path_, std::ios::binary | std::ios::trunc);
+        file_.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    }
+
+    if (!file_)
+    {
+        throw LogStoreException{"Can't open " + path_ + " for writing"};
+    }
+}
+
+void blockparser::LogSink::begin_block(Block const& block, uint256 const& hash, size_t height)
+{
+    if (height != next_height_)
+    {
+        throw LogStoreException{"Expected block " + std::to_string(next_height_) + " for " + path_ + ", got " +
+                                std::to_string(height)};
+    }
+
+    block_record_        = {};
+    block_record_.type   = logstore::block;
+    block_record_.height = static_cast<uint32_t>(height);
+    block_record_.index  = static_cast<uint32_t>(block.transactions().size());
+    std::memcpy(block_record_.hash, hash.begin(), sizeof(block_record_.hash));
+
+    pending_.clear();
+    touched_.clear();
+}
+
+void blockparser::LogSink::put_output(OutPoint const& outpoint, Coin const& coin)
+{
+    pending_.push_back(outpoint_record(logstore::output, outpoint, coin, block_record_.height));
+    if (!coin.address.empty())
+    {
+        touched_.insert(coin.address);
+    }
+}
+
+void blockparser::LogSink::spend(OutPoint const& outpoint, Coin const& coin)
+{
+    pending_.push_back(outpoint_record(logstore::spend, outpoint, coin, block_record_.height));
+    if (!coin.address.empty())
+    {
+        touched_.insert(coin.address);
+    }
+}
+
+void blockparser::LogSink::end_block(UtxoSet const& utxos)
+{
+    for (auto&& address : touched_)
+    {
+        LogRecord record{};
+        record.type   = logstore::balance;
+        record.height = block_record_.height;
+        record.amount = utxos.balances().at(address);
+        copy_address(record.address, address);
+
+        auto& last{last_balance_.try_emplace(address, no_record).first->second};
+        record.link = last;
+        last        = records_ + pending_.size();
+
+        pending_.push_back(record);
+    }
+
+    block_record_.link = checksum(pending_.data(), pending_.size());
+    pending_.push_back(block_record_);
+
+    file_.write(reinterpret_cast<char const*>(pending_.data()),
+                static_cast<std::streamsize>(pending_.size() * sizeof(LogRecord)));
+    if (!file_)
+    {
+        throw LogStoreException{"Failed to write " + path_};
+    }
+
+    records_ += pending_.size();
+    next_height_++;
+    std::memcpy(tip_.begin(), block_record_.hash, sizeof(block_record_.hash));
+}
+
+void blockparser::LogSink::flush()
+{
+    file_.flush();
+    if (!file_)
+    {
+        throw LogStoreException{"Failed to write " + path_};
+    }
+}
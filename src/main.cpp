@@ -1,10 +1,29 @@
-#include "redis.hpp"
+#include "address_index.hpp"
+#include "applier.hpp"
+#include "clusters.hpp"
+#include "columnar.hpp"
+#include "flow.hpp"
+#include "funding_index.hpp"
+#include "log_store.hpp"
+#include "rdb.hpp"
+#include "redis_shards.hpp"
+#include "redis_sink.hpp"
+#include "rewards.hpp"
+#include "rich_list.hpp"
+#include "server.hpp"
+#include "snapshot.hpp"
+#include "supply.hpp"
+#include "tx_index.hpp"
 #include "types.hpp"
+#include "utxo_histogram.hpp"
 
 #include <chrono>
+#include <map>
 #include <datfile.hpp>
+#include <sys/stat.h>
 #include <thread>
 #include <util.hpp>
+#include <zenon/utilstrencodings.h>
 
 // In the regular zenon / pivx / bitcoin code, the blocks are deserialized in main.cpp:LoadExternalBlockfile.
 // The deserialization logic is implemented in the CBlock / CTransaction / CTxIn etc. classes by expansion
@@ -37,110 +56,671 @@ using BlockPtr = std::shared_ptr<blockparser::Block>;
 using BlockMap = std::unordered_map<uint256, BlockPtr, blockparser::detail::uint256_hash>;
 using TxMap    = blockparser::TxMap;
 
-/*
-void store_block(BlockMap const& blocks, TxMap const& txs, uint256 const& hash)
+// Locations of all blocks, written after the first scan of the blockfiles, and the txid index. Both are kept in
+// the --index directory, by default the one that is read, so indexes of different chains don't mix.
+static std::string const block_index_name{"block-parser.idx"};
+static std::string const tx_index_name{"block-parser.txi"};
+// The chain log getbalance reads by default, in the directory that is read.
+static std::string const chain_log_name{"block-parser.log"};
+
+// blk00000.dat, blk00001.dat, ...
+std::string blockfile_path(std::string const& where, size_t i)
+{
+    std::stringstream ss;
+    ss << where << "/blk" << std::setw(5) << std::setfill('0') << i << ".dat";
+    return ss.str();
+}
+
+// naive way to enumerate the available blockdata files in directory where:
+// try opening sequentially until that fails.
+auto enumerate_blockfiles(std::string where)
+{
+    std::vector<std::string> paths;
+    while (std::ifstream{blockfile_path(where, paths.size())}.good())
+    {
+        paths.push_back(blockfile_path(where, paths.size()));
+    }
+
+    assert(!paths.empty()); // else not even blk00000.dat was readable
+    return paths;
+}
+
+void print_reorder_stats(blockparser::ChainApplier const& applier)
 {
-    auto const& block{blocks.at(hash)};
-    //std::cout << "Storing block " << block->height() << " with " << block->transactions().size() << " txns" <<
-std::endl;
-    //redis::store_block(block, hash);
+    std::cout << "Orphan buffer peak: " << applier.peak_buffered_blocks() << " blocks, "
+              << applier.peak_buffered_bytes() << " bytes parsed, " << applier.spilled() << " spilled" << std::endl;
+}
+
+// Parse a non-negative decimal number; what names it in the error.
+size_t parse_size(std::string const& value, std::string const& what)
+{
+    if (value.empty() || value.size() > 19 || !std::all_of(value.begin(), value.end(), ::isdigit))
+    {
+        throw blockparser::ArgumentException{"Invalid " + what + " '" + value + "'"};
+    }
+
+    return std::stoull(value);
+}
 
-    for (auto&& tx : block->transactions())
+// Positional arguments and --name=value options, in any order.
+struct Arguments
+{
+    std::vector<std::string> positional{};
+    std::map<std::string, std::string> options{};
+
+    Arguments(int argc, char** argv)
     {
-        // for all utxo's: increase the 'balance' of the associated pubkey
-        for (auto&& utxo : tx.vout)
+        for (int i{1}; i < argc; ++i)
         {
-            if (!utxo.address.empty())
+            std::string const arg{argv[i]};
+            auto const eq{arg.find('=')};
+
+            if (arg.rfind("--", 0) == 0 && eq != std::string::npos)
             {
-                redis::modify_balance(utxo.address, utxo.amount);
+                options[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
             }
+            else
+            {
+                positional.push_back(arg);
+            }
+        }
+    }
+
+    /// True if the mode given after the directory is name, with its operand.
+    bool mode(std::string const& name) const { return positional.size() > 2 && positional[1] == name; }
+    std::string const& operand() const { return positional.at(2); }
+
+    std::string option(std::string const& name, std::string const& fallback) const
+    {
+        auto it{options.find(name)};
+        return it == options.end() ? fallback : it->second;
+    }
+
+    /// The number given as option name, in [min, max]; throws an ArgumentException naming the option otherwise.
+    size_t number(std::string const& name, size_t fallback, size_t min = 0, size_t max = SIZE_MAX) const
+    {
+        auto it{options.find(name)};
+        if (it == options.end()) return fallback;
+
+        auto const value{parse_size(it->second, "--" + name)};
+        if (value < min || value > max)
+        {
+            throw blockparser::ArgumentException{"--" + name + "=" + it->second + " is not in [" +
+                                                 std::to_string(min) + ", " + std::to_string(max) + "]"};
         }
 
-        // for all utxi's: increase the 'balance' of the associated pubkey and store various linkages
-        for (auto&& txi : tx.vin)
+        return value;
+    }
+};
+
+// Bring the UTXO snapshot at path up to the tip of the main chain. If the file exists, its state is
+// loaded and only the blocks following its tip are parsed and applied; else the whole chain is replayed.
+void update_snapshot(std::string const& path, blockparser::ChainIndex const& chain, blockparser::ChainApplier& applier)
+{
+    blockparser::UtxoSet utxos;
+
+    if (struct stat st{}; ::stat(path.c_str(), &st) == 0)
+    {
+        blockparser::MappedSnapshot snapshot{path};
+
+        if (!chain.contains(snapshot.tip(), snapshot.height()))
         {
-            if (claims_output(txi))  // not the coinbase
-            {
-                auto referenced_tx{txs.find(txi.tx_hash)};
-                if (referenced_tx == txs.end())
-                {
-                    std::cerr << "Non-referencing txi in block " << hash.ToString() << ": "
-                              << txi.tx_hash << std::endl;
-                    continue;
-                }
+            throw blockparser::SnapshotException{"Tip " + snapshot.tip().ToString() + " at height " +
+                                                 std::to_string(snapshot.height()) + " is not on the main chain"};
+        }
 
-                auto referenced_block{blocks.find(referenced_tx->second)};
-                if (referenced_block == blocks.end())
-                {
-                    std::cerr << "Missing block referenced in tx: " << hash.ToString() << std::endl;
-                    continue;
-                }
+        utxos = snapshot.to_utxo_set();
+        std::cout << "Loaded snapshot at height " << snapshot.height() << " with " << snapshot.coin_count()
+                  << " unspent outputs" << std::endl;
+    }
+
+    applier.run(utxos.next_height(), [&](auto const& block, auto const& entry, size_t height)
+                { utxos.apply(*block, entry.hash, height); });
+    print_reorder_stats(applier);
+
+    blockparser::write_snapshot(path, utxos);
+    std::cout << "Wrote snapshot at height " << (utxos.next_height() - 1) << " with " << utxos.coins().size()
+              << " unspent outputs and " << utxos.balances().size() << " addresses to " << path << std::endl;
+}
+
+// Print a block of the main chain as hex, by hash or height.
+void print_block(std::string const& key, std::vector<std::string> const& blockfiles,
+                 blockparser::BlockIndex const& index, blockparser::ChainIndex const& chain)
+{
+    blockparser::BlockLocation location;
+    if (key.size() == 64)
+    {
+        auto const* entry{index.find(uint256S(key))};
+        if (!entry)
+        {
+            throw blockparser::ArgumentException{"Unknown block hash " + key};
+        }
+        location = entry->location;
+    }
+    else
+    {
+        auto const height{parse_size(key, "height")};
+        if (height >= chain.size())
+        {
+            throw blockparser::ArgumentException{"Height " + key + " is not on the main chain of " +
+                                                 std::to_string(chain.size()) + " blocks"};
+        }
+        location = chain[height].location;
+    }
+
+    std::cout << HexStr(blockparser::Datfile::read_raw(blockfiles.at(location.file), location)) << std::endl;
+}
+
+// Look up a transaction by txid through the persisted tx index, which is first brought up to the tip of the
+// main chain. An index whose tip left the main chain is rebuilt.
+void print_transaction(uint256 const& txid, std::string const& tx_index_path,
+                       std::vector<std::string> const& blockfiles, blockparser::ChainIndex const& chain,
+                       blockparser::ChainApplier& applier)
+{
+    blockparser::TxIndex txindex;
+    if (txindex.load(tx_index_path) && !chain.contains(txindex.tip(), txindex.next_height() - 1))
+    {
+        std::cout << "Tx index tip " << txindex.tip() << " is not on the main chain, rebuilding" << std::endl;
+        txindex = {};
+    }
+
+    if (txindex.next_height() < chain.size())
+    {
+        applier.run(txindex.next_height(), [&](auto const& block, auto const& entry, size_t height)
+                    { txindex.add(*block, entry, height); });
+        txindex.save(tx_index_path);
+        std::cout << "Indexed " << txindex.size() << " transactions up to height " << txindex.next_height() - 1
+                  << std::endl;
+    }
 
-                bool found{};
-                for (auto&& block_tx : referenced_block->second->transactions())
+    for (auto&& location : txindex.find(txid))
+    {
+        std::ifstream stream{blockfiles.at(location.file), std::ios::in | std::ios::binary};
+        stream.seekg(location.block_offset + location.tx_offset);
+
+        auto const tx{blockparser::read_transaction(stream)};
+        if (tx.hash == txid)
+        {
+            std::cout << "Found in file " << location.file << " at offset "
+                      << location.block_offset + location.tx_offset << " (" << location.size << " bytes)" << std::endl;
+            std::cout << tx << std::endl;
+            return;
+        }
+    }
+
+    std::cout << "Transaction " << txid << " not found on the main chain" << std::endl;
+}
+
+// Write the commands that store the main chain in redis as a RESP file, to be loaded with redis-cli --pipe.
+void export_resp(std::ostream& os, redis::Schema const& schema, blockparser::ChainApplier& applier)
+{
+    blockparser::UtxoSet utxos;
+    size_t commands{};
+
+    applier.run(0,
+                [&](auto const& block, auto const& entry, size_t height)
                 {
-                    if (block_tx.hash == txi.tx_hash)
-                    {
-                        found = true;
-                        auto const& vout{block_tx.vout[txi.index]};
+                    auto const delta{utxos.apply(*block, entry.hash, height)};
+                    auto block_commands{schema.block(*block, entry.hash, delta, utxos)};
+                    block_commands.push_back(schema.top(height));
 
-                        redis::modify_balance(vout.address, -vout.amount);
-                        redis::link_vout_to_block(vout.address, block_tx.hash.ToString());
-                        redis::link_vout_to_tx(vout.address, tx.hash.ToString());
+                    for (auto&& command : block_commands)
+                    {
+                        redis::write_resp(os, command);
+                        commands++;
                     }
-                }
-                if (!found)
+                });
+
+    os.flush();
+    if (!os)
+    {
+        throw blockparser::RedisException{"Failed to write the RESP output"};
+    }
+
+    print_reorder_stats(applier);
+    std::cout << "Wrote " << commands << " commands" << std::endl;
+}
+
+// Write the keyspace that storing the main chain in redis would produce as an RDB file.
+void export_rdb(std::string const& path, redis::Schema const& schema, blockparser::ChainApplier& applier)
+{
+    blockparser::UtxoSet utxos;
+    redis::RdbWriter rdb{path};
+
+    applier.run(0,
+                [&](auto const& block, auto const& entry, size_t height)
                 {
-                    std::cerr << "Could not associate txi in block " << hash.ToString() << std::endl;
-                }
-            }
+                    auto const delta{utxos.apply(*block, entry.hash, height)};
+                    for (auto&& command : schema.block(*block, entry.hash, delta, utxos))
+                    {
+                        rdb.apply(command);
+                    }
+                });
+
+    // set once for the tip, not per block
+    rdb.apply(schema.top(utxos.next_height() - 1));
+    rdb.close();
+
+    print_reorder_stats(applier);
+    std::cout << "Wrote " << rdb.keys() << " keys to " << path << std::endl;
+}
+
+// Write the main chain as columnar tables into directory.
+void export_columnar(blockparser::ColumnarSink::Options const& options, blockparser::ChainApplier& applier)
+{
+    blockparser::ColumnarSink sink{options};
+    blockparser::UtxoSet utxos;
+
+    applier.run(utxos, sink);
+    print_reorder_stats(applier);
+
+    std::cout << "Wrote " << sink.rows() << " rows of blocks, txs, vin and vout to " << options.directory
+              << std::endl;
+}
+
+// Write the money supply per height to path, then compare the supply at the tip with the sum of the unspent
+// outputs and the zerocoin pool; the difference are outputs the UTXO set doesn't track (unspendable ones).
+void audit_supply(std::string const& path, blockparser::SupplySink::Format format,
+                  blockparser::ChainApplier& applier)
+{
+    blockparser::SupplySink sink{path, format};
+    blockparser::UtxoSet utxos;
+
+    applier.run(utxos, sink);
+    print_reorder_stats(applier);
+
+    int64_t unspent{};
+    for (auto&& entry : utxos.coins())
+    {
+        unspent += entry.second.amount;
+    }
+
+    std::cout << "Supply at height " << (utxos.next_height() - 1) << ": " << sink.supply() << ", unspent outputs "
+              << unspent << ", zerocoin pool " << utxos.zerocoin_pool() << ", difference "
+              << (sink.supply() - unspent - utxos.zerocoin_pool()) << std::endl;
+    std::cout << sink.anomalies() << " transactions paid out more than they claimed" << std::endl;
+}
+
+// Write the coin flow metrics per height to path, and print the totals.
+void write_flow(std::string const& path, blockparser::FlowSink::Format format, blockparser::ChainApplier& applier)
+{
+    blockparser::FlowSink sink{path, format};
+    blockparser::UtxoSet utxos;
+
+    applier.run(utxos, sink);
+    print_reorder_stats(applier);
+
+    std::cout << "Coin flow up to height " << (utxos.next_height() - 1) << ": " << sink.volume()
+              << " transferred, " << sink.cdd() << " coin-days destroyed" << std::endl;
+}
+
+// Cluster the addresses by common input ownership up to height and write the clusters (id, first address, size,
+// balance at height) to path, by balance. If members_path isn't empty, the cluster of every address is written
+// there.
+void write_clusters(std::string const& path, std::string const& members_path,
+                    blockparser::ClusterSink::Options const& options, blockparser::ChainApplier& applier)
+{
+    blockparser::ClusterSink sink{options};
+    blockparser::UtxoSet utxos;
+
+    applier.run(utxos, sink);
+    print_reorder_stats(applier);
+
+    std::ofstream file{path, std::ios::trunc};
+    file << "cluster,address,size,balance\n";
+    for (auto&& cluster : sink.clusters())
+    {
+        file << cluster.id << ',' << sink.addresses().address(cluster.id) << ',' << cluster.size << ','
+             << cluster.balance << '\n';
+    }
+
+    if (!members_path.empty())
+    {
+        std::ofstream members{members_path, std::ios::trunc};
+        members << "address,cluster\n";
+        for (uint32_t id{}; id < sink.cluster_ids().size(); ++id)
+        {
+            members << sink.addresses().address(id) << ',' << sink.cluster_ids()[id] << '\n';
         }
     }
+
+    auto const largest{std::max_element(sink.clusters().begin(), sink.clusters().end(),
+                                        [](auto const& lhs, auto const& rhs) { return lhs.size < rhs.size; })};
+
+    std::cout << "Clustered " << sink.addresses().size() << " addresses into " << sink.clusters().size()
+              << " clusters at height " << sink.height().value_or(0) << ", the largest has "
+              << (largest == sink.clusters().end() ? 0 : largest->size) << " addresses" << std::endl;
 }
-*/
 
-std::string str_tolower(std::string s)
+// Write the zerocoin mints and spends per height and denomination to path, and print their totals.
+void audit_zerocoin(std::string const& path, blockparser::ChainApplier& applier)
 {
-    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); } // correct
-    );
-    return s;
+    blockparser::ZerocoinSink sink{path};
+    blockparser::UtxoSet utxos;
+
+    applier.run(utxos, sink);
+    print_reorder_stats(applier);
+
+    for (auto&& [denomination, total] : sink.totals())
+    {
+        std::cout << "Denomination " << denomination << ": " << total.mints << " mints (" << total.minted << "), "
+                  << total.spends << " spends (" << total.spent << ")" << std::endl;
+    }
+
+    std::cout << "Zerocoin pool at height " << (utxos.next_height() - 1) << ": " << utxos.zerocoin_pool()
+              << std::endl;
 }
 
-// naive way to enumerate the available blockdata files in directory where:
-// try opening sequentially until that fails.
-auto enumerate_blockfiles(std::string where)
+// Parse a comma separated list of heights.
+std::vector<size_t> parse_heights(std::string const& list)
+{
+    std::vector<size_t> heights;
+
+    std::stringstream ss{list};
+    for (std::string height; std::getline(ss, height, ',');)
+    {
+        heights.push_back(parse_size(height, "height in --heights"));
+    }
+
+    return heights;
+}
+
+// Write the top balances at the heights of options to path (height, rank, address, balance, share of the total),
+// and print the concentration of the balances at each height.
+void write_rich_list(std::string const& path, blockparser::RichListSink::Options const& options,
+                     blockparser::ChainApplier& applier)
+{
+    blockparser::RichListSink sink{options};
+    blockparser::UtxoSet utxos;
+
+    applier.run(utxos, sink);
+    print_reorder_stats(applier);
+
+    std::ofstream file{path, std::ios::trunc};
+    file << "height,rank,address,balance,share\n";
+
+    for (auto&& distribution : sink.distributions())
+    {
+        auto const share = [&](int64_t balance)
+        {
+            return distribution.total ? static_cast<double>(balance) / distribution.total : 0.0;
+        };
+
+        for (size_t rank{}; rank < distribution.top.size(); ++rank)
+        {
+            auto const& [address, balance]{distribution.top[rank]};
+            file << distribution.height << ',' << (rank + 1) << ',' << address << ',' << balance << ','
+                 << share(balance) << '\n';
+        }
+
+        std::cout << "Height " << distribution.height << ": " << distribution.holders << " addresses hold "
+                  << distribution.total << ", Gini " << distribution.gini << ", the top " << distribution.top.size()
+                  << " hold " << (100 * share(distribution.top_total)) << "%" << std::endl;
+    }
+}
+
+// Write the age and amount histograms of the unspent outputs at the heights of options to path.
+void write_utxo_histograms(std::string const& path, blockparser::UtxoHistogramSink::Options const& options,
+                           blockparser::ChainApplier& applier)
+{
+    blockparser::UtxoHistogramSink sink{path, options};
+    blockparser::UtxoSet utxos;
+
+    applier.run(utxos, sink);
+    print_reorder_stats(applier);
+
+    std::cout << "Wrote the UTXO histograms at " << sink.written() << " heights up to "
+              << (utxos.next_height() - 1) << std::endl;
+}
+
+// Print the stake and node rewards per bucket and address as a table sorted by bucket and address. Buckets of
+// days are labelled with their first day, buckets of blocks with their first height.
+void print_rewards(blockparser::RewardSink::Options const& options, blockparser::ChainApplier& applier)
+{
+    blockparser::RewardSink sink{options};
+    blockparser::UtxoSet utxos;
+
+    applier.run(utxos, sink);
+    print_reorder_stats(applier);
+
+    std::cout << "bucket\taddress\tstake_reward\tstakes\tnode_reward\tnodes" << std::endl;
+    for (auto&& [key, total] : sink.table())
+    {
+        auto const& [bucket, address]{key};
+
+        if (options.days)
+        {
+            auto const time{static_cast<std::time_t>(bucket * options.bucket * 86400)};
+            std::cout << std::put_time(std::gmtime(&time), "%Y-%m-%d");
+        }
+        else
+        {
+            std::cout << bucket * options.bucket;
+        }
+
+        std::cout << "\t" << address << "\t" << total.stake << "\t" << total.stakes << "\t" << total.node << "\t"
+                  << total.nodes << std::endl;
+    }
+}
+
+// Print the distinct senders to a comma separated list of addresses, with the amounts attributed to them.
+void print_senders(std::string const& list, blockparser::ChainApplier& applier)
+{
+    std::vector<std::string> addresses;
+    std::stringstream ss{list};
+    for (std::string address; std::getline(ss, address, ',');)
+    {
+        addresses.push_back(address);
+    }
+
+    blockparser::FundingIndex index;
+    blockparser::UtxoSet utxos;
+
+    applier.run(utxos, index);
+    print_reorder_stats(applier);
+
+    for (auto&& address : addresses)
+    {
+        auto const fundings{index.fundings(address)};
+        std::cout << address << " was funded by " << fundings.size() << " of " << index.funding_txs()
+                  << " funding transactions" << std::endl;
+    }
+
+    for (auto&& sender : index.senders(addresses))
+    {
+        std::cout << sender.address << " " << sender.amount << " in " << sender.txs << " txs" << std::endl;
+    }
+}
+
+// Print the number of addresses starting with prefix (ignoring case) and the first limit of them. The addresses
+// are those of the snapshot at snapshot_path if given, else of the main chain.
+void find_prefix(std::string const& prefix, size_t limit, std::string const& snapshot_path,
+                 blockparser::ChainApplier& applier)
+{
+    std::vector<std::string> addresses;
+
+    if (!snapshot_path.empty())
+    {
+        blockparser::MappedSnapshot snapshot{snapshot_path};
+        for (size_t i{}; i < snapshot.balance_count(); ++i)
+        {
+            addresses.push_back(blockparser::snapshot::address(snapshot.balances()[i].address));
+        }
+    }
+    else
+    {
+        blockparser::UtxoSet utxos;
+        applier.run(0, [&](auto const& block, auto const& entry, size_t height)
+                    { utxos.apply(*block, entry.hash, height); });
+
+        for (auto&& entry : utxos.balances())
+        {
+            addresses.push_back(entry.first);
+        }
+    }
+
+    blockparser::AddressIndex const index{std::move(addresses)};
+    std::cout << "Indexed " << index.size() << " addresses in " << index.bytes() << " bytes" << std::endl;
+
+    auto const start{std::chrono::steady_clock::now()};
+    auto const count{index.count(prefix)};
+    auto const matches{index.find(prefix, limit)};
+    auto const elapsed{std::chrono::steady_clock::now() - start};
+
+    for (auto&& address : matches)
+    {
+        std::cout << address << std::endl;
+    }
+
+    std::cout << "Found " << count << " addresses starting with " << prefix << " in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << " us" << std::endl;
+}
+
+// Index the main chain in memory and answer queries on it until the process is stopped.
+void serve(blockparser::QueryServer::Options const& options, blockparser::ChainApplier& applier)
+{
+    blockparser::QueryIndex index;
+    blockparser::UtxoSet utxos;
+
+    applier.run(utxos, index);
+    print_reorder_stats(applier);
+
+    blockparser::QueryServer server{index, options};
+    std::cout << "Serving " << index.blocks() << " blocks on " << options.host << ":" << server.port() << " with "
+              << options.workers << " workers" << std::endl;
+
+    server.run();
+}
+
+// Bring the chain log at path up to the tip of the main chain. The UTXO set is rebuilt from genesis, but only the
+// blocks following the tip of the log are appended.
+void update_log(std::string const& path, blockparser::ChainIndex const& chain, blockparser::ChainApplier& applier)
 {
-    std::ifstream file{where + "/blk00000.dat"};
-    size_t i{};
-    for (; file.good(); i++)
+    blockparser::LogSink sink{path};
+
+    if (sink.next_height() && !chain.contains(sink.tip(), sink.next_height() - 1))
     {
-        auto const num{std::string{"000"} + ((i + 1) < 10 ? "0" : "") + std::to_string(i + 1)};
-        auto const filename{where + "/blk" + num + ".dat"};
-        file = std::ifstream{filename};
+        throw blockparser::LogStoreException{"Tip " + sink.tip().ToString() + " of " + path +
+                                             " is not on the main chain, remove the file to rebuild it"};
     }
 
-    assert(i > 0); // else not even blk00000.dat was readable
-    return i - 1;
+    if (sink.next_height())
+    {
+        std::cout << "Continuing " << path << " after height " << sink.next_height() - 1 << std::endl;
+    }
+
+    blockparser::UtxoSet utxos;
+    applier.run(utxos, sink);
+    print_reorder_stats(applier);
+
+    std::cout << "Wrote " << path << " up to height " << sink.next_height() - 1 << ", " << sink.records()
+              << " records" << std::endl;
+}
+
+// Print the balance of an address at a height from the chain log.
+void print_balance(std::string const& path, std::string const& address, size_t height)
+{
+    blockparser::MappedLog const log{path};
+    if (!log.next_height())
+    {
+        throw blockparser::LogStoreException{path + " contains no blocks"};
+    }
+
+    height = std::min(height, log.next_height() - 1);
+
+    if (auto const balance{log.balance(address, height)})
+    {
+        std::cout << address << " at height " << height << ": " << *balance << std::endl;
+    }
+    else
+    {
+        std::cout << address << " has no transactions up to height " << height << std::endl;
+    }
 }
 
 int main(int argc, char** argv)
 {
-    // Not all of these scripts might work with the current iteration of the code.
-    // redis::load_script("redis-scripts/getallutxos.lua");
-    // redis::load_script("redis-scripts/getutxovalue.lua");
-    // redis::load_script("redis-scripts/getblocks.lua");
-    // redis::load_script("redis-scripts/gettxinputs.lua");
-    // redis::load_script("redis-scripts/gettxsconsumingpk.lua");
-    // std::this_thread::sleep_for(std::chrono::seconds(2));
-    // return 0;
+    Arguments const args{argc, argv};
 
-    if (argc < 2)
+    if (args.positional.empty())
     {
         std::cout << "Please pass the absolute path to the directory containing the 'blocks' folder" << std::endl;
+        std::cout << "Usage: " << argv[0] << " <dir>                   store the main chain in redis" << std::endl;
+        std::cout << "       " << argv[0] << " <dir> snapshot <file>   create or update a UTXO snapshot" << std::endl;
+        std::cout << "       " << argv[0] << " <dir> getblock <hash|height>  print a raw block as hex" << std::endl;
+        std::cout << "       " << argv[0] << " <dir> gettx <txid>      print a main chain transaction" << std::endl;
+        std::cout << "       " << argv[0] << " <dir> export-resp <file|->  write the redis commands as RESP"
+                  << std::endl;
+        std::cout << "       " << argv[0] << " <dir> export-rdb <file>  write the redis keyspace as RDB file"
+                  << std::endl;
+        std::cout << "       " << argv[0] << " <dir> export-columnar <dir>  write blocks, txs, vin and vout tables"
+                  << std::endl;
+        std::cout << "       " << argv[0] << " <dir> log <file>        create or update the embedded chain log"
+                  << std::endl;
+        std::cout << "       " << argv[0] << " <dir> getbalance <address>  print a balance from the chain log"
+                  << std::endl;
+        std::cout << "       " << argv[0] << " <dir> supply <file>     write minted, fees and supply per height"
+                  << std::endl;
+        std::cout << "       " << argv[0] << " <dir> flow <file>       write coin-days destroyed and volume per height"
+                  << std::endl;
+        std::cout << "       " << argv[0] << " <dir> clusters <file>   cluster addresses by common input ownership"
+                  << std::endl;
+        std::cout << "       " << argv[0] << " <dir> histograms <file>  write UTXO age and amount histograms"
+                  << std::endl;
+        std::cout << "       " << argv[0] << " <dir> richlist <file>   write the top balances and their concentration"
+                  << std::endl;
+        std::cout << "       " << argv[0] << " <dir> zerocoin <file>   write zerocoin mints and spends per height"
+                  << std::endl;
+        std::cout << "       " << argv[0] << " <dir> rewards              sum stake and node rewards per address"
+                  << std::endl;
+        std::cout << "       " << argv[0] << " <dir> senders <address>[,<address>...]  list who paid to addresses"
+                  << std::endl;
+        std::cout << "       " << argv[0] << " <dir> findprefix <prefix>  list addresses starting with prefix"
+                  << std::endl;
+        std::cout << "       " << argv[0] << " <dir> serve                answer queries on the main chain over TCP"
+                  << std::endl;
+        std::cout << "Options: --schema=classic|compact  the redis key schema (store, export-resp, export-rdb)"
+                  << std::endl;
+        std::cout << "         --redis=host:port,/unix/socket,...  the redis servers to store to (store)" << std::endl;
+        std::cout << "         --sharding=client|cluster  independent servers, or nodes of a redis cluster (store)"
+                  << std::endl;
+        std::cout << "         --checkpoint=<blocks>  blocks between progress markers (store, default 1000)"
+                  << std::endl;
+        std::cout << "         --format=parquet|arrow  the table files (export-columnar, default parquet)" << std::endl;
+        std::cout << "         --row-group=<blocks>  blocks per row group (export-columnar, default 10000)"
+                  << std::endl;
+        std::cout << "         --index=<dir>  where " << block_index_name << " and " << tx_index_name
+                  << " are kept (default <dir>)" << std::endl;
+        std::cout << "         --log=<file>  the chain log to read (getbalance, default <dir>/" << chain_log_name << ")"
+                  << std::endl;
+        std::cout << "         --height=<n>  the height of the balance (getbalance, clusters, default the tip)"
+                  << std::endl;
+        std::cout << "         --format=binary|csv  the supply or flow table (supply, flow, default binary)"
+                  << std::endl;
+        std::cout << "         --members=<file>  also write the cluster of every address (clusters)" << std::endl;
+        std::cout << "         --heights=<n>[,<n>...]  the heights (histograms, richlist, default the tip)"
+                  << std::endl;
+        std::cout << "         --every=<blocks>  also every multiple of blocks (histograms)" << std::endl;
+        std::cout << "         --top=<n>  the balances to list per height (richlist, default 100)" << std::endl;
+        std::cout << "         --bucket=<blocks>|<days>d  the rows of the reward table (rewards, default 10000)"
+                  << std::endl;
+        std::cout << "         --from=<height> --to=<height>  the blocks to sum (rewards, default all)" << std::endl;
+        std::cout << "         --snapshot=<file>  take the addresses from a snapshot (findprefix)" << std::endl;
+        std::cout << "         --limit=<n>  the addresses to list (findprefix, default 20)" << std::endl;
+        std::cout << "         --host=<ipv4> --port=<n>  the address to listen on (serve, default 127.0.0.1:8335)"
+                  << std::endl;
+        std::cout << "         --workers=<n>  threads answering queries (serve, default 4)" << std::endl;
         return -1;
     }
 
-    auto const blocksdir{std::string{argv[1]}};
+    auto const blocksdir{args.positional[0]};
+    auto const index_dir{args.option("index", blocksdir)};
+    auto const block_index_path{index_dir + "/" + block_index_name};
+    auto const tx_index_path{index_dir + "/" + tx_index_name};
+
+    // RESP on stdout: everything else that is printed goes to stderr
+    auto const resp_to_stdout{args.mode("export-resp") && args.operand() == "-"};
+    auto* const stdout_buffer{resp_to_stdout ? std::cout.rdbuf(std::cerr.rdbuf()) : std::cout.rdbuf()};
 
     if (std::ifstream{blocksdir + "/Zenon.conf"}.is_open())
     {
@@ -161,156 +741,426 @@ int main(int argc, char** argv)
         }
     }
 
-    std::vector<std::unique_ptr<blockparser::Datfile>> datfiles;
-    BlockMap blocks;
-    blockparser::Block* genesis{nullptr};    // first block
-    blockparser::Block* last_block{nullptr}; // for reverse iteration to build the linked list
+    // Index all headers first; the transactions are only parsed once the main chain is known.
+    // Headers of files that did not change since the last run are restored from the persisted index.
+    auto const blockfiles{enumerate_blockfiles(blocksdir + "/blocks")};
+    std::vector<blockparser::FileStamp> stamps;
+    std::transform(blockfiles.begin(), blockfiles.end(), std::back_inserter(stamps), blockparser::file_stamp);
 
-    for (size_t i{}; i <= enumerate_blockfiles(blocksdir + "/blocks"); ++i)
+    blockparser::BlockIndex index;
+    auto const fresh{index.load(block_index_path, stamps)};
+    auto const restored{static_cast<size_t>(std::count(fresh.begin(), fresh.end(), true))};
+
+    if (restored)
     {
+        std::cout << "Restored " << index.size() << " headers of " << restored << " blockfiles from "
+                  << block_index_path << std::endl;
+    }
+
+    for (size_t i{}; i < blockfiles.size(); ++i)
+    {
+        if (fresh[i]) continue;
+
         try
         {
-            auto num = (i < 10 ? "0" : "") + std::to_string(i);
+            blockparser::Datfile::index_headers(blockfiles[i], static_cast<uint32_t>(i), index);
+        }
 
-            blockparser::Datfile datfile{blocksdir + "/blocks/blk000" + num + ".dat"};
+        catch (blockparser::ParseException const& pe)
+        {
+            std::cout << __func__ << ": " << pe.what() << " in file " << i << std::endl;
+        }
+    }
 
-            if (i == 0)
-            {
-                genesis    = datfile.blocks().front().get();
-                last_block = genesis;
-            }
+    // The tip is the block with the most cumulative work, independent of where it is stored.
+    index.select_best_chain();
+    assert(index.tip());
+
+    if (restored < blockfiles.size())
+    {
+        index.save(block_index_path, stamps);
+    }
+
+    blockparser::ChainIndex const chain{index};
+    std::cout << "Best tip " << chain.tip().hash << " at height " << chain.size() - 1 << " ("
+              << index.tips().size() - 1 << " alternative tips, " << index.unlinked() << " unlinked blocks)"
+              << std::endl;
+    std::cout << "Linked " << chain.size() << " blocks from " << index.size() << " available." << std::endl;
+    std::cout << "Removed " << index.size() - chain.size() << " blocks." << std::endl;
+
+    if (args.mode("getblock"))
+    {
+        try
+        {
+            print_block(args.operand(), blockfiles, index, chain);
+        }
+
+        catch (blockparser::exception const& e)
+        {
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
 
-            for (auto&& block : datfile.blocks())
+    blockparser::ChainApplier applier{chain, blockfiles};
+
+    if (args.mode("gettx"))
+    {
+        try
+        {
+            print_transaction(uint256S(args.operand()), tx_index_path, blockfiles, chain, applier);
+        }
+
+        catch (blockparser::exception const& e)
+        {
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
+
+    if (args.mode("export-resp"))
+    {
+        try
+        {
+            std::ofstream file;
+            if (!resp_to_stdout)
             {
-                blocks[blockparser::hash(block->header())] = block;
+                file.open(args.operand(), std::ios::binary | std::ios::trunc);
             }
 
-            last_block = datfile.blocks().back().get();
+            std::ostream os{resp_to_stdout ? stdout_buffer : file.rdbuf()};
+            export_resp(os, redis::make_schema(args.option("schema", "classic")), applier);
         }
 
-        catch (blockparser::ParseException const& pe)
+        catch (blockparser::exception const& e)
         {
-            std::cout << __func__ << ": " << pe.what() << " at block " << datfiles.back()->blocks().size()
-                      << " of file " << i << std::endl;
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
         }
+
+        return 0;
     }
 
-    assert(genesis && last_block);
+    if (args.mode("export-rdb"))
+    {
+        try
+        {
+            export_rdb(args.operand(), redis::make_schema(args.option("schema", "classic")), applier);
+        }
+
+        catch (blockparser::exception const& e)
+        {
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
 
-    // By reverse iterating and forward linking all blocks, we get rid of blocks from forked chains.
-    size_t count{0};
-    for (auto* block{last_block}; block != genesis; count++)
+    if (args.mode("export-columnar"))
     {
-        auto const block_hash{blockparser::hash(block->header())};
-        assert(blocks.at(block_hash).get() == block);
+        try
+        {
+            blockparser::ColumnarSink::Options options;
+            options.directory        = args.operand();
+            options.format           = args.option("format", "parquet") == "arrow"
+                                           ? blockparser::ColumnarSink::Format::ipc
+                                           : blockparser::ColumnarSink::Format::parquet;
+            options.row_group_blocks = args.number("row-group", 10000, 1);
+            options.threads          = std::max(1u, std::thread::hardware_concurrency());
+
+            export_columnar(options, applier);
+        }
 
-        auto const& prev_hash{block->header().hash_previous_block_};
-        blocks.at(prev_hash)->set_follower(block_hash);
-        block = blocks[prev_hash].get();
+        catch (blockparser::exception const& e)
+        {
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
+        }
+
+        return 0;
     }
 
-    std::cout << "Linked " << (count + 1) << " blocks from " << blocks.size() << " available." << std::endl;
-    assert(last_block->follower().IsNull());
+    if (args.mode("log"))
+    {
+        try
+        {
+            update_log(args.operand(), chain, applier);
+        }
+
+        catch (blockparser::exception const& e)
+        {
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
+        }
 
-    // set the actual block height now
-    last_block->set_height(count);
+        return 0;
+    }
 
-    size_t height{};
-    for (auto* block{genesis}; !block->follower().IsNull(); block = blocks[block->follower()].get())
+    if (args.mode("getbalance"))
     {
-        block->set_height(height++);
-        if (block->follower().IsNull()) assert(block == last_block);
+        try
+        {
+            print_balance(args.option("log", blocksdir + "/" + chain_log_name), args.operand(),
+                          args.number("height", SIZE_MAX));
+        }
+
+        catch (blockparser::exception const& e)
+        {
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
+        }
+
+        return 0;
     }
 
-    assert(last_block->height() == height);
-    assert(blocks[last_block->header().hash_previous_block_]->height() == last_block->height() - 1);
+    if (args.mode("supply"))
+    {
+        try
+        {
+            audit_supply(args.operand(),
+                         args.option("format", "binary") == "csv" ? blockparser::SupplySink::Format::csv
+                                                                  : blockparser::SupplySink::Format::binary,
+                         applier);
+        }
+
+        catch (blockparser::exception const& e)
+        {
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
 
-    // Free some space by removing blocks from forked chains.
-    size_t removed{};
-    for (auto it{blocks.begin()}; it != blocks.end();)
+    if (args.mode("flow"))
     {
-        auto const& previous_hash{it->second->header().hash_previous_block_};
-        assert(!previous_hash.IsNull() || it->second.get() == genesis);
+        try
+        {
+            write_flow(args.operand(),
+                       args.option("format", "binary") == "csv" ? blockparser::FlowSink::Format::csv
+                                                                : blockparser::FlowSink::Format::binary,
+                       applier);
+        }
 
-        auto previous_is_deleted{blocks.find(previous_hash) == std::end(blocks)};
+        catch (blockparser::exception const& e)
+        {
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
 
-        if (it->second.get() != genesis && (previous_is_deleted || blocks[previous_hash]->follower() != it->first))
+    if (args.mode("clusters"))
+    {
+        try
         {
-            // std::cout << "Erasing block " << it->second->height() << ": " << blockparser::hash(it->second->header())
-            // << std::endl;
-            it = blocks.erase(it);
-            removed++;
+            blockparser::ClusterSink::Options options;
+            options.height  = args.number("height", SIZE_MAX);
+            options.threads = std::max(1u, std::thread::hardware_concurrency());
+
+            write_clusters(args.operand(), args.option("members", ""), options, applier);
         }
-        else
+
+        catch (blockparser::exception const& e)
         {
-            ++it;
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
         }
+
+        return 0;
     }
 
-    std::cout << "Removed " << removed << " blocks." << std::endl;
-    assert(last_block->follower().IsNull());
+    if (args.mode("histograms"))
+    {
+        try
+        {
+            blockparser::UtxoHistogramSink::Options options;
+            options.heights = parse_heights(args.option("heights", ""));
+            options.every   = args.number("every", 0);
+
+            write_utxo_histograms(args.operand(), options, applier);
+        }
+
+        catch (blockparser::exception const& e)
+        {
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
 
-    // validation: Iterating through the chain now by following the follewer-links, we should have
-    // a height-sequence of increments by one. Initial height must be 0.
-    size_t control_height{0};
-    for (auto hash{blockparser::hash(genesis->header())}; !hash.IsNull(); hash = blocks[hash]->follower())
+    if (args.mode("richlist"))
     {
-        auto actual_height{blocks[hash]->height()};
-        if (actual_height != control_height)
+        try
+        {
+            blockparser::RichListSink::Options options;
+            options.heights = parse_heights(args.option("heights", ""));
+            options.top     = args.number("top", 100);
+
+            write_rich_list(args.operand(), options, applier);
+        }
+
+        catch (blockparser::exception const& e)
         {
-            std::cout << "Expected height " << control_height << ", found " << actual_height << std::endl;
-            assert(false);
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
         }
-        control_height++;
+
+        return 0;
     }
 
-    std::cout << "Storing blockmap of size " << blocks.size() << " in database" << std::endl;
+    if (args.mode("zerocoin"))
+    {
+        try
+        {
+            audit_zerocoin(args.operand(), applier);
+        }
 
-    try
+        catch (blockparser::exception const& e)
+        {
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
+
+    if (args.positional.size() > 1 && args.positional[1] == "rewards")
     {
-        for (auto hash{blockparser::hash(genesis->header())}; !hash.IsNull();)
+        try
+        {
+            auto const bucket{args.option("bucket", "10000")};
+
+            blockparser::RewardSink::Options options;
+            options.days    = !bucket.empty() && bucket.back() == 'd';
+            options.bucket  = std::max(1ul, parse_size(options.days ? bucket.substr(0, bucket.size() - 1) : bucket,
+                                                       "--bucket"));
+            options.from    = args.number("from", 0);
+            options.to      = args.number("to", SIZE_MAX);
+            options.threads = std::max(1u, std::thread::hardware_concurrency());
+
+            print_rewards(options, applier);
+        }
+
+        catch (blockparser::exception const& e)
         {
-            auto block_ptr{blocks[hash]};
-            redis::store_block(block_ptr, hash.ToString());
-            // Free space when stored in db
-            blocks.erase(hash);
-            hash = block_ptr->follower();
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
         }
+
+        return 0;
     }
 
-    catch (blockparser::RedisException const& re)
+    if (args.mode("senders"))
     {
-        std::cout << __func__ << ": " << re.what() << std::endl;
+        try
+        {
+            print_senders(args.operand(), applier);
+        }
+
+        catch (blockparser::exception const& e)
+        {
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
+        }
+
+        return 0;
     }
-}
 
-/*
+    if (args.mode("findprefix"))
+    {
+        try
+        {
+            find_prefix(args.operand(), args.number("limit", 20), args.option("snapshot", ""),
+                        applier);
+        }
 
-auto& datfile{datfiles.back()};
-auto const hashmap{datfile->blockhashtable()};
-auto genesis{std::find_if(hashmap.cbegin(), hashmap.cend(), [](auto const& entry) {
-    return !entry.second->header().hash_previous_block_;
-})};
+        catch (blockparser::exception const& e)
+        {
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
+        }
 
-if (genesis != hashmap.end())
-{
-    std::cout << std::endl
-              << "Genesis block: " << genesis->first << ": " << *genesis->second << std::endl;
-}
+        return 0;
+    }
 
-for (auto&& block : datfile->blocks())
-{
-    store_block(datfile->blockhashtable(), datfile->tx2blockhashmap(),
-                blockparser::hash(block->header()));
-    redis::commit();
+    if (args.positional.size() > 1 && args.positional[1] == "serve")
+    {
+        try
+        {
+            blockparser::QueryServer::Options options;
+            options.host    = args.option("host", options.host);
+            options.port    = static_cast<uint16_t>(args.number("port", options.port, 1, UINT16_MAX));
+            options.workers = args.number("workers", options.workers, 1);
+
+            serve(options, applier);
+        }
+
+        catch (blockparser::exception const& e)
+        {
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
+
+    if (args.mode("snapshot"))
+    {
+        try
+        {
+            update_snapshot(args.operand(), chain, applier);
+        }
+
+        catch (blockparser::exception const& e)
+        {
+            std::cout << __func__ << ": " << e.what() << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
+
+    std::cout << "Storing " << chain.size() << " blocks in database" << std::endl;
+
+    try
+    {
+        // Inputs are resolved from the in-process UTXO set, so the commands of many blocks can be in flight.
+        redis::ShardedWriter writer{redis::parse_endpoints(args.option("redis", "127.0.0.1:6379")),
+                                    args.option("sharding", "client") == "cluster"};
+        redis::RedisSink sink{redis::make_schema(args.option("schema", "classic")), writer,
+                              args.number("checkpoint", 1000, 1)};
+
+        // Blocks below the stored progress are still applied and fed to the schema (the UTXO set and the
+        // compact schema's address ids and history offsets are built from genesis), but their commands are
+        // not sent again.
+        if (sink.resume_height())
+        {
+            std::cout << "Continuing after height " << sink.resume_height() - 1 << ", which is stored already"
+                      << std::endl;
+        }
+
+        blockparser::UtxoSet utxos;
+        applier.run(utxos, sink);
+
+        print_reorder_stats(applier);
+        std::cout << "Sent " << writer.sent() << " commands to " << writer.shards() << " servers, peak in flight "
+                  << writer.peak_inflight_bytes() << " bytes" << std::endl;
+    }
+
+    catch (blockparser::exception const& e)
+    {
+        std::cout << __func__ << ": " << e.what() << std::endl;
+    }
 }
 
-auto const addr{"put-some-znn-address-here"};
-blockparser::PubkeyPool::on_key(addr, [&](auto const& vec) {
-    redis::set_hashes_test(addr, vec);
-    for (auto&& str : vec) std::cout << str << std::endl;
-});
-*/
 /*
     TxMap tx2blockmap_;
     BlockMap blocks;
@@ -396,39 +1246,6 @@ blockparser::PubkeyPool::on_key(addr, [&](auto const& vec) {
 
     std::cout << "TxCount:   " << tx2blockmap_.size() << std::endl;
 
-#ifndef WITH_REDIS
-    std::vector<std::string> prefixes = {"zm", "zmn", "zmns", "zmnsc", "zmnscp", "zmnscpx", "zmnscpxj"};
-    std::vector<std::vector<string>> addresses;
-
-    addresses.push_back({});
-    blockparser::PubkeyPool::on_all([&](auto const& map) {
-        for (auto&& entry: map) {
-            addresses.back().push_back(entry.first);
-        }
-    });
-
-    std::cout << "Found " << addresses.back().size() << " addresses" << std::endl;
-
-    size_t i{};
-    for (auto&& prefix: prefixes)
-    {
-        addresses.emplace_back();
-        std::copy_if(addresses[i].begin(), addresses[i].end(), std::back_inserter(addresses.back()),
-                     [&](auto const& address) { return str_tolower(address.substr(0, prefix.length())) == prefix; });
-        std::cout << "Found " << addresses.back().size() << " addresses starting with " << prefix << std::endl;
-        i++;
-    }
-
-#else
-
-    std::cout << "Storing blocks in REDIT" << std::endl;
-    for (auto current{genesis_hash}; !current.IsNull(); current = blocks[current]->follower())
-    {
-        auto const& block{blocks[current]};
-        redis::store_block(block, current.ToString());
-        // store_block(blocks, tx2blockmap_, current);
-    }
-#endif
     return 0;
 }
 */
@@ -0,0 +1,145 @@
+#include "query_index.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+void blockparser::QueryIndex::begin_block(Block const& block, uint256 const& hash, size_t height)
+{
+    BlockInfo info{hash, block.header().hash_merkle_root_, block.header().time_, {}};
+
+    claiming_txs_.clear();
+    claimed_ = 0;
+    touched_.clear();
+
+    for (auto&& tx : block.transactions())
+    {
+        info.txids.push_back(tx.hash);
+        txs_[tx.hash] = {static_cast<uint32_t>(height), static_cast<uint32_t>(tx.vout.size()), {}};
+
+        for (auto&& vin : tx.vin)
+        {
+            if (claims_output(vin))
+            {
+                claiming_txs_.push_back(tx.hash);
+            }
+        }
+    }
+
+    blocks_.push_back(std::move(info));
+}
+
+void blockparser::QueryIndex::put_output(OutPoint const&, Coin const& coin)
+{
+    if (!coin.address.empty())
+    {
+        touched_.push_back(coin.address);
+    }
+}
+
+void blockparser::QueryIndex::spend(OutPoint const& outpoint, Coin const& coin)
+{
+    auto const& txid{claiming_txs_.at(claimed_++)};
+
+    txs_.at(txid).inputs.push_back({outpoint, coin});
+    spenders_[outpoint] = {txid, static_cast<uint32_t>(blocks_.size() - 1)};
+
+    if (!coin.address.empty())
+    {
+        auto& txids{spending_txs_[coin.address]};
+        if (txids.empty() || txids.back() != txid)
+        {
+            txids.push_back(txid);
+        }
+
+        touched_.push_back(coin.address);
+    }
+}
+
+void blockparser::QueryIndex::end_block(UtxoSet const& utxos)
+{
+    std::sort(touched_.begin(), touched_.end());
+    touched_.erase(std::unique(touched_.begin(), touched_.end()), touched_.end());
+
+    auto const height{static_cast<uint32_t>(blocks_.size() - 1)};
+    for (auto&& address : touched_)
+    {
+        history_[address].push_back({height, utxos.balances().at(address)});
+    }
+
+    utxos_ = &utxos;
+}
+
+void blockparser::QueryIndex::flush()
+{
+    if (!utxos_) return;
+
+    unspent_.clear();
+    for (auto&& [outpoint, coin] : utxos_->coins())
+    {
+        if (!coin.address.empty())
+        {
+            unspent_[coin.address].emplace_back(outpoint, coin);
+        }
+    }
+
+    for (auto&& [address, coins] : unspent_)
+    {
+        std::sort(coins.begin(), coins.end(),
+                  [](auto const& lhs, auto const& rhs)
+                  {
+                      return std::tie(lhs.second.height, lhs.first.hash, lhs.first.index) <
+                             std::tie(rhs.second.height, rhs.first.hash, rhs.first.index);
+                  });
+    }
+
+    std::vector<std::string> addresses;
+    addresses.reserve(history_.size());
+    for (auto&& entry : history_)
+    {
+        addresses.push_back(entry.first);
+    }
+    addresses_ = AddressIndex{std::move(addresses)};
+
+    utxos_ = nullptr;
+}
+
+blockparser::QueryIndex::TxInfo const* blockparser::QueryIndex::tx(uint256 const& txid) const
+{
+    auto const it{txs_.find(txid)};
+    return it == txs_.end() ? nullptr : &it->second;
+}
+
+std::optional<blockparser::QueryIndex::Spender> blockparser::QueryIndex::spender(OutPoint const& outpoint) const
+{
+    auto const it{spenders_.find(outpoint)};
+    return it == spenders_.end() ? std::nullopt : std::make_optional(it->second);
+}
+
+std::vector<uint256> const& blockparser::QueryIndex::spending_txs(std::string const& address) const
+{
+    static std::vector<uint256> const none{};
+    auto const it{spending_txs_.find(address)};
+    return it == spending_txs_.end() ? none : it->second;
+}
+
+std::optional<int64_t> blockparser::QueryIndex::balance(std::string const& address, size_t height) const
+{
+    auto const it{history_.find(address)};
+    if (it == history_.end()) return std::nullopt;
+
+    // the last change at or below height
+    auto const& changes{it->second};
+    auto const next{std::upper_bound(changes.begin(), changes.end(), height,
+                                     [](size_t height, BalanceChange const& change)
+                                     { return height < change.height; })};
+
+    return next == changes.begin() ? std::nullopt : std::make_optional(std::prev(next)->balance);
+}
+
+std::vector<std::pair<blockparser::OutPoint, blockparser::Coin>> const&
+blockparser::QueryIndex::unspent(std::string const& address) const
+{
+    static std::vector<std::pair<OutPoint, Coin>> const none{};
+    auto const it{unspent_.find(address)};
+    return it == unspent_.end() ? none : it->second;
+}
@@ -0,0 +1,341 @@
+#include "rdb.hpp"
+
+#include "exception.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <zenon/crypto/sha256.h>
+
+namespace
+{
+    // RDB opcodes and value types, see rdb.h in the redis sources
+    uint8_t constexpr rdb_opcode_aux{0xfa};
+    uint8_t constexpr rdb_opcode_selectdb{0xfe};
+    uint8_t constexpr rdb_opcode_eof{0xff};
+
+    uint8_t constexpr rdb_type_string{0};
+    uint8_t constexpr rdb_type_set{2};
+    uint8_t constexpr rdb_type_hash{4};
+    uint8_t constexpr rdb_type_zset_2{5};
+    uint8_t constexpr rdb_type_set_intset{11};
+
+    char constexpr rdb_magic[]{"REDIS0009"};
+
+    auto const crc64_table{[]
+                           {
+                               std::array<uint64_t, 256> table{};
+                               for (uint64_t i{}; i < table.size(); ++i)
+                               {
+                                   auto crc{i};
+                                   for (int bit{}; bit < 8; ++bit)
+                                   {
+                                       crc = crc & 1 ? (crc >> 1) ^ 0x95ac9329ac4bc9b5ull : crc >> 1;
+                                   }
+                                   table[i] = crc;
+                               }
+                               return table;
+                           }()};
+
+    // redis keeps a set member as integer only if it is the canonical representation of an int64
+    bool as_integer(std::string const& member, int64_t& value)
+    {
+        auto const* const last{member.data() + member.size()};
+        auto const [end, error]{std::from_chars(member.data(), last, value)};
+        return error == std::errc{} && end == last && std::to_string(value) == member;
+    }
+
+    template <typename T> void append_le(std::string& blob, T value)
+    {
+        for (size_t i{}; i < sizeof(T); ++i)
+        {
+            blob.push_back(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xff));
+        }
+    }
+
+    // intset blob: encoding (bytes per value), length, values ascending; all little endian
+    template <typename T> std::string intset(std::vector<int64_t> const& values)
+    {
+        std::string blob;
+        append_le<uint32_t>(blob, sizeof(T));
+        append_le<uint32_t>(blob, static_cast<uint32_t>(values.size()));
+        for (auto value : values)
+        {
+            append_le<T>(blob, static_cast<T>(value));
+        }
+        return blob;
+    }
+} // namespace
+
+uint64_t redis::crc64(uint64_t crc, unsigned char const* data, size_t size)
+{
+    for (size_t i{}; i < size; ++i)
+    {
+        crc = crc64_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+redis::RdbWriter::RdbWriter(std::string path)
+    : path_{std::move(path)}, tmp_path_{path_ + ".tmp"}, file_{tmp_path_, std::ios::binary | std::ios::trunc}
+{
+    if (!file_)
+    {
+        throw blockparser::RdbException{"Can't open " + tmp_path_};
+    }
+
+    put(rdb_magic, sizeof(rdb_magic) - 1);
+
+    put_byte(rdb_opcode_aux);
+    put_string("redis-bits");
+    put_string("64");
+
+    put_byte(rdb_opcode_selectdb);
+    put_length(0);
+}
+
+void redis::RdbWriter::put(void const* data, size_t size)
+{
+    crc_ = crc64(crc_, static_cast<unsigned char const*>(data), size);
+    file_.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+}
+
+void redis::RdbWriter::put_length(uint64_t length)
+{
+    if (length < (1u << 6))
+    {
+        put_byte(static_cast<uint8_t>(length));
+    }
+    else if (length < (1u << 14))
+    {
+        put_byte(static_cast<uint8_t>(0x40 | (length >> 8)));
+        put_byte(static_cast<uint8_t>(length & 0xff));
+    }
+    else if (length <= UINT32_MAX)
+    {
+        uint8_t const encoded[]{0x80, static_cast<uint8_t>(length >> 24), static_cast<uint8_t>(length >> 16),
+                                static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(length)};
+        put(encoded, sizeof(encoded));
+    }
+    else
+    {
+        put_byte(0x81);
+        for (int shift{56}; shift >= 0; shift -= 8)
+        {
+            put_byte(static_cast<uint8_t>(length >> shift));
+        }
+    }
+}
+
+void redis::RdbWriter::put_string(std::string const& value)
+{
+    put_length(value.size());
+    put(value.data(), value.size());
+}
+
+void redis::RdbWriter::put_key(uint8_t type, std::string const& key)
+{
+    put_byte(type);
+    put_string(key);
+
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    CSHA256{}.Write(reinterpret_cast<unsigned char const*>(key.data()), key.size()).Finalize(hash);
+
+    auto& digest{digests_.emplace_back()};
+    std::memcpy(digest.data(), hash, digest.size());
+}
+
+void redis::RdbWriter::write_string(std::string const& key, std::string const& value)
+{
+    put_key(rdb_type_string, key);
+    put_string(value);
+    keys_++;
+}
+
+void redis::RdbWriter::write_set(std::string const& key, std::vector<std::string>& members)
+{
+    std::sort(members.begin(), members.end());
+    members.erase(std::unique(members.begin(), members.end()), members.end());
+
+    std::vector<int64_t> values;
+    if (members.size() <= max_intset_entries)
+    {
+        for (auto&& member : members)
+        {
+            int64_t value{};
+            if (!as_integer(member, value)) break;
+            values.push_back(value);
+        }
+    }
+
+    if (!members.empty() && values.size() == members.size())
+    {
+        std::sort(values.begin(), values.end());
+        auto const [min, max]{std::minmax_element(values.begin(), values.end())};
+
+        put_key(rdb_type_set_intset, key);
+
+        if (*min >= INT16_MIN && *max <= INT16_MAX)
+        {
+            put_string(intset<int16_t>(values));
+        }
+        else if (*min >= INT32_MIN && *max <= INT32_MAX)
+        {
+            put_string(intset<int32_t>(values));
+        }
+        else
+        {
+            put_string(intset<int64_t>(values));
+        }
+    }
+    else
+    {
+        put_key(rdb_type_set, key);
+        put_length(members.size());
+        for (auto&& member : members)
+        {
+            put_string(member);
+        }
+    }
+
+    keys_++;
+}
+
+void redis::RdbWriter::write_hash(std::string const& key,
+                                  std::unordered_map<std::string, std::string> const& fields)
+{
+    put_key(rdb_type_hash, key);
+    put_length(fields.size());
+    for (auto&& [field, value] : fields)
+    {
+        put_string(field);
+        put_string(value);
+    }
+
+    keys_++;
+}
+
+void redis::RdbWriter::write_zset(std::string const& key, std::unordered_map<std::string, double> const& members)
+{
+    put_key(rdb_type_zset_2, key);
+    put_length(members.size());
+    for (auto&& [member, score] : members)
+    {
+        // the score as binary IEEE 754 double, little endian
+        uint64_t bits{};
+        std::memcpy(&bits, &score, sizeof(bits));
+
+        std::string blob;
+        append_le<uint64_t>(blob, bits);
+
+        put_string(member);
+        put(blob.data(), blob.size());
+    }
+
+    keys_++;
+}
+
+void redis::RdbWriter::apply(command_t const& command)
+{
+    if (command.size() == 3 && command[0] == "SET")
+    {
+        write_string(command[1], command[2]);
+    }
+    else if (command.size() >= 3 && command[0] == "SADD")
+    {
+        auto& members{sets_[command[1]]};
+        members.insert(members.end(), command.begin() + 2, command.end());
+    }
+    else if (command.size() >= 4 && command.size() % 2 == 0 && command[0] == "HSET")
+    {
+        auto& fields{hashes_[command[1]]};
+        for (size_t i{2}; i < command.size(); i += 2)
+        {
+            fields[command[i]] = command[i + 1];
+        }
+    }
+    else if (command.size() >= 4 && command.size() % 2 == 0 && command[0] == "ZADD")
+    {
+        auto& members{zsets_[command[1]]};
+        for (size_t i{2}; i < command.size(); i += 2)
+        {
+            members[command[i + 1]] = std::stod(command[i]);
+        }
+    }
+    else if (command.size() == 3 && command[0] == "APPEND")
+    {
+        ranged_[command[1]] += command[2];
+    }
+    else if (command.size() == 4 && command[0] == "SETRANGE")
+    {
+        auto& value{ranged_[command[1]]};
+        auto const offset{std::stoul(command[2])};
+        if (value.size() < offset + command[3].size())
+        {
+            value.resize(offset + command[3].size(), '\0');
+        }
+        value.replace(offset, command[3].size(), command[3]);
+    }
+    else
+    {
+        throw blockparser::RdbException{"Unsupported command " + (command.empty() ? "" : command[0])};
+    }
+}
+
+void redis::RdbWriter::close()
+{
+    for (auto&& [key, members] : sets_)
+    {
+        write_set(key, members);
+    }
+    sets_.clear();
+
+    for (auto&& [key, fields] : hashes_)
+    {
+        write_hash(key, fields);
+    }
+    hashes_.clear();
+
+    for (auto&& [key, members] : zsets_)
+    {
+        write_zset(key, members);
+    }
+    zsets_.clear();
+
+    for (auto&& [key, value] : ranged_)
+    {
+        write_string(key, value);
+    }
+    ranged_.clear();
+
+    std::sort(digests_.begin(), digests_.end());
+    auto const unique{std::unique(digests_.begin(), digests_.end())};
+    auto const duplicates{static_cast<size_t>(digests_.end() - unique)};
+    digests_.clear();
+
+    if (duplicates)
+    {
+        file_.close();
+        std::remove(tmp_path_.c_str());
+        throw blockparser::RdbException{std::to_string(duplicates) + " keys were written more than once, " +
+                                        "redis wouldn't load " + path_};
+    }
+
+    put_byte(rdb_opcode_eof);
+
+    // the checksum itself is stored little endian and not part of the checksum
+    uint8_t checksum[8];
+    for (size_t i{}; i < sizeof(checksum); ++i)
+    {
+        checksum[i] = static_cast<uint8_t>(crc_ >> (8 * i));
+    }
+    file_.write(reinterpret_cast<char const*>(checksum), sizeof(checksum));
+    file_.close();
+
+    if (!file_ || std::rename(tmp_path_.c_str(), path_.c_str()) != 0)
+    {
+        throw blockparser::RdbException{"Failed to write " + path_};
+    }
+}
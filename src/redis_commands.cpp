@@ -0,0 +1,129 @@
+#include "redis_commands.hpp"
+
+#include "exception.hpp"
+#include "redis_compact.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+std::vector<redis::command_t> redis::block_commands(blockparser::Block const& block, uint256 const& hash,
+                                                    blockparser::BlockDelta const& delta,
+                                                    blockparser::UtxoSet const& utxos)
+{
+    auto const height{std::to_string(block.height())};
+    auto const& transactions{block.transactions()};
+
+    std::vector<command_t> commands;
+
+    // store the block hash under znn:block:hash:<height>
+    commands.push_back({"SET", "znn:block:hash:" + height, hash.ToString()});
+
+    // store all transaction hashes in a set znn:block:txns:<height>
+    command_t txns{"SADD", "znn:block:txns:" + height};
+    std::transform(transactions.begin(), transactions.end(), std::back_inserter(txns),
+                   [](auto const& tx) { return tx.hash.ToString(); });
+    commands.push_back(std::move(txns));
+
+    std::unordered_map<std::string, int64_t> balance_updates;
+
+    for (auto&& tx : transactions)
+    {
+        auto const tx_hash{tx.hash.ToString()};
+
+        // store every vout with a unique id; empty addresses are coinbase nonstandard outputs
+        for (size_t i{}; i < tx.vout.size(); ++i)
+        {
+            auto const si{std::to_string(i)};
+            auto const& vout{tx.vout[i]};
+
+            if (vout.address.empty()) continue;
+
+            if (vout.address.length() != 34)
+            {
+                throw blockparser::RedisException{"In block " + height + ", TX=" + tx_hash + ":\n" + "Address was " +
+                                                  vout.address + ", index " + si + ", amount " +
+                                                  std::to_string(vout.amount)};
+            }
+
+            commands.push_back({"SET", "znn:tx:" + tx_hash + ":n:" + si, vout.address});
+            commands.push_back({"SET", "znn:tx:" + tx_hash + ":amount:" + si, std::to_string(vout.amount)});
+
+            if (vout.amount > 0)
+            {
+                balance_updates[vout.address] += vout.amount;
+            }
+        }
+    }
+
+    // spent outputs decrease the balance of the spending address
+    for (auto&& [outpoint, coin] : delta.spent)
+    {
+        if (!coin.address.empty())
+        {
+            balance_updates[coin.address] -= coin.amount;
+        }
+    }
+
+    if (balance_updates.empty())
+    {
+        throw blockparser::RedisException{"Block " + height + ": Empty UTXO set."};
+    }
+
+    // store every address as a member of the set of known addresses
+    command_t addresses{"SADD", "znn:utxos"};
+    std::transform(balance_updates.begin(), balance_updates.end(), std::back_inserter(addresses),
+                   [](auto const& pair) { return pair.first; });
+    commands.push_back(std::move(addresses));
+
+    // store this block as a point of change for every address, with the total change during the block, and
+    // the balance after the block in a sorted set scored by height: the balance at a height is the last member
+    // scored up to it. Members are <height>:<balance>, so that equal balances at different heights stay apart.
+    auto const& balances{utxos.balances()};
+    for (auto&& [key, balance_update] : balance_updates)
+    {
+        auto const balance{balances.find(key)};
+        auto const cumulative{balance == balances.end() ? int64_t{} : balance->second};
+
+        commands.push_back({"SADD", "znn:blocks:" + key, height});
+        commands.push_back({"SET", "znn:change:" + key + ":" + height, std::to_string(balance_update)});
+        commands.push_back({"ZADD", "znn:balance:" + key, height, height + ":" + std::to_string(cumulative)});
+    }
+
+    return commands;
+}
+
+redis::command_t redis::top_command(size_t height)
+{
+    return {"SET", "znn:blocks:top", std::to_string(height)};
+}
+
+redis::Schema redis::make_schema(std::string const& name)
+{
+    if (name == "classic")
+    {
+        return {name, block_commands, top_command};
+    }
+
+    if (name == "compact")
+    {
+        // the address ids are assigned while storing, so the schema instance lives as long as the Schema
+        auto compact{std::make_shared<CompactSchema>()};
+        return {name,
+                [compact](auto const& block, auto const& hash, auto const& delta, auto const&)
+                { return compact->block_commands(block, hash, delta); },
+                CompactSchema::top_command};
+    }
+
+    throw blockparser::RedisException{"Unknown schema " + name};
+}
+
+void redis::write_resp(std::ostream& os, command_t const& command)
+{
+    os << '*' << command.size() << "\r\n";
+    for (auto&& arg : command)
+    {
+        os << '$' << arg.size() << "\r\n";
+        os.write(arg.data(), static_cast<std::streamsize>(arg.size()));
+        os << "\r\n";
+    }
+}
@@ -0,0 +1,100 @@
+#include "redis_compact.hpp"
+
+#include <algorithm>
+#include <map>
+
+namespace
+{
+    template <typename T> void append_le(std::string& packed, T value)
+    {
+        for (size_t i{}; i < sizeof(T); ++i)
+        {
+            packed.push_back(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xff));
+        }
+    }
+
+    // in the byte order of the hex representation
+    std::string binary(uint256 const& hash)
+    {
+        std::string bytes{hash.begin(), hash.end()};
+        std::reverse(bytes.begin(), bytes.end());
+        return bytes;
+    }
+
+    std::string bucket(size_t n) { return std::to_string(n / redis::CompactSchema::bucket_size); }
+    std::string slot(size_t n) { return std::to_string(n % redis::CompactSchema::bucket_size); }
+} // namespace
+
+std::vector<redis::command_t> redis::CompactSchema::block_commands(blockparser::Block const& block,
+                                                                   uint256 const& hash,
+                                                                   blockparser::BlockDelta const& delta)
+{
+    auto const height{block.height()};
+    std::vector<command_t> commands;
+
+    std::string block_value{binary(hash)};
+
+    // ordered by id, so the commands don't depend on the hash order of the addresses
+    std::map<uint32_t, int64_t> balance_updates;
+
+    for (auto&& tx : block.transactions())
+    {
+        auto const txid{binary(tx.hash)};
+        block_value += txid;
+
+        std::string outputs;
+        for (size_t i{}; i < tx.vout.size(); ++i)
+        {
+            auto const& vout{tx.vout[i]};
+            if (vout.address.empty()) continue;
+
+            auto const [id, inserted]{addresses_.insert(vout.address)};
+            if (inserted)
+            {
+                history_records_.push_back(0);
+                commands.push_back({"HSET", "znn:c:addr:" + bucket(id), slot(id), vout.address});
+                commands.push_back({"HSET", "znn:c:ids", vout.address, std::to_string(id)});
+            }
+
+            append_le<uint32_t>(outputs, static_cast<uint32_t>(i));
+            append_le<uint32_t>(outputs, id);
+            append_le<int64_t>(outputs, vout.amount);
+
+            if (vout.amount > 0)
+            {
+                balance_updates[id] += vout.amount;
+            }
+        }
+
+        if (!outputs.empty())
+        {
+            commands.push_back({"HSET", "znn:c:out:" + txid.substr(0, 2), txid.substr(2), std::move(outputs)});
+        }
+    }
+
+    for (auto&& [outpoint, coin] : delta.spent)
+    {
+        if (auto id{addresses_.find(coin.address)})
+        {
+            balance_updates[*id] -= coin.amount;
+        }
+    }
+
+    commands.push_back({"HSET", "znn:c:blk:" + bucket(height), slot(height), std::move(block_value)});
+
+    for (auto&& [id, balance_update] : balance_updates)
+    {
+        std::string record;
+        append_le<uint32_t>(record, static_cast<uint32_t>(height));
+        append_le<int64_t>(record, balance_update);
+        auto const offset{history_records_[id]++ * history_record_size};
+        commands.push_back({"SETRANGE", "znn:c:hist:" + std::to_string(id), std::to_string(offset), std::move(record)});
+    }
+
+    return commands;
+}
+
+redis::command_t redis::CompactSchema::top_command(size_t height)
+{
+    return {"SET", "znn:c:top", std::to_string(height)};
+}
@@ -0,0 +1,259 @@
+#include "redis_shards.hpp"
+
+#include "exception.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+    // CRC16/XMODEM (polynomial 0x1021), as in the redis cluster specification
+    uint16_t crc16(char const* data, size_t size)
+    {
+        uint16_t crc{};
+        for (size_t i{}; i < size; ++i)
+        {
+            crc ^= static_cast<uint16_t>(static_cast<uint8_t>(data[i]) << 8);
+            for (int bit{}; bit < 8; ++bit)
+            {
+                crc = crc & 0x8000 ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+            }
+        }
+        return crc;
+    }
+} // namespace
+
+std::vector<redis::Endpoint> redis::parse_endpoints(std::string const& list)
+{
+    std::vector<Endpoint> endpoints;
+
+    std::stringstream ss{list};
+    for (std::string item; std::getline(ss, item, ',');)
+    {
+        if (item.empty()) continue;
+
+        if (item.front() == '/')
+        {
+            endpoints.push_back({item, 0});
+            continue;
+        }
+
+        auto const colon{item.rfind(':')};
+        if (colon == std::string::npos || colon + 1 == item.size() || item.size() - colon - 1 > 5 ||
+            item.find_first_not_of("0123456789", colon + 1) != std::string::npos ||
+            std::stoul(item.substr(colon + 1)) > 65535)
+        {
+            throw blockparser::RedisException{"Invalid endpoint " + item + ", expected host:port or /socket/path"};
+        }
+
+        endpoints.push_back({item.substr(0, colon), std::stoul(item.substr(colon + 1))});
+    }
+
+    if (endpoints.empty())
+    {
+        throw blockparser::RedisException{"No redis endpoints in '" + list + "'"};
+    }
+
+    return endpoints;
+}
+
+size_t redis::key_slot(std::string const& key)
+{
+    auto const open{key.find('{')};
+    if (open != std::string::npos)
+    {
+        auto const close{key.find('}', open + 1)};
+        if (close != std::string::npos && close != open + 1)
+        {
+            return crc16(key.data() + open + 1, close - open - 1) % cluster_slots;
+        }
+    }
+
+    return crc16(key.data(), key.size()) % cluster_slots;
+}
+
+redis::ShardedWriter::ShardedWriter(std::vector<Endpoint> const& endpoints, bool cluster,
+                                    PipelinedWriter::Options const& options)
+{
+    if (endpoints.empty())
+    {
+        throw blockparser::RedisException{"No redis endpoints"};
+    }
+
+    if (cluster)
+    {
+        map_cluster_slots(endpoints.front(), options);
+        return;
+    }
+
+    for (auto&& endpoint : endpoints)
+    {
+        auto shard_options{options};
+        shard_options.host = endpoint.host;
+        shard_options.port = endpoint.port;
+        writers_.push_back(std::make_unique<PipelinedWriter>(shard_options));
+    }
+
+    for (size_t slot{}; slot < cluster_slots; ++slot)
+    {
+        slot_writer_[slot] = static_cast<uint16_t>(slot % writers_.size());
+    }
+}
+
+void redis::ShardedWriter::map_cluster_slots(Endpoint const& seed, PipelinedWriter::Options const& options)
+{
+    cpp_redis::reply reply;
+
+    try
+    {
+        cpp_redis::client client;
+        client.connect(seed.host, seed.port);
+
+        auto future{client.send({"CLUSTER", "SLOTS"})};
+        client.sync_commit();
+        reply = future.get();
+    }
+
+    catch (std::exception const& e)
+    {
+        throw blockparser::RedisException{"Could not connect to " + seed.host + ":" + std::to_string(seed.port) +
+                                          ": " + e.what()};
+    }
+
+    if (!reply.is_array() || reply.as_array().empty())
+    {
+        throw blockparser::RedisException{"CLUSTER SLOTS failed on " + seed.host + ":" + std::to_string(seed.port) +
+                                          (reply.is_error() ? ": " + reply.as_string() : "")};
+    }
+
+    std::vector<Endpoint> masters;
+    std::vector<bool> covered(cluster_slots);
+
+    // entries are [first slot, last slot, [master ip, master port, ...], replicas...]
+    for (auto&& range : reply.as_array())
+    {
+        auto const& fields{range.as_array()};
+        auto const& master{fields.at(2).as_array()};
+        Endpoint const endpoint{master.at(0).as_string(), static_cast<size_t>(master.at(1).as_integer())};
+
+        auto it{std::find(masters.begin(), masters.end(), endpoint)};
+        if (it == masters.end())
+        {
+            it = masters.insert(masters.end(), endpoint);
+        }
+
+        auto const last{std::min<size_t>(fields.at(1).as_integer(), cluster_slots - 1)};
+        for (auto slot{static_cast<size_t>(fields.at(0).as_integer())}; slot <= last; ++slot)
+        {
+            slot_writer_[slot] = static_cast<uint16_t>(it - masters.begin());
+            covered[slot]      = true;
+        }
+    }
+
+    if (std::find(covered.begin(), covered.end(), false) != covered.end())
+    {
+        throw blockparser::RedisException{"Not all cluster slots are served"};
+    }
+
+    for (auto&& endpoint : masters)
+    {
+        auto shard_options{options};
+        shard_options.host = endpoint.host;
+        shard_options.port = endpoint.port;
+        writers_.push_back(std::make_unique<PipelinedWriter>(shard_options));
+    }
+}
+
+size_t redis::ShardedWriter::read_progress(std::string const& schema)
+{
+    marker_keys_.assign(writers_.size(), {});
+    next_heights_.assign(writers_.size(), 0);
+
+    // find a hash tag for each shard that places the marker on it
+    size_t found{};
+    for (size_t tag{}; found < writers_.size(); ++tag)
+    {
+        auto const key{"znn:load:" + schema + ":{" + std::to_string(tag) + "}"};
+        auto& marker_key{marker_keys_[slot_writer_[key_slot(key)]]};
+
+        if (marker_key.empty())
+        {
+            marker_key = key;
+            found++;
+        }
+    }
+
+    for (size_t i{}; i < writers_.size(); ++i)
+    {
+        if (auto const height{writers_[i]->get(marker_keys_[i])})
+        {
+            next_heights_[i] = std::stoul(*height) + 1;
+        }
+    }
+
+    return *std::min_element(next_heights_.begin(), next_heights_.end());
+}
+
+void redis::ShardedWriter::send(std::vector<command_t> commands, size_t height)
+{
+    for (auto&& command : commands)
+    {
+        auto const i{shard(command)};
+        if (i < next_heights_.size() && height < next_heights_[i]) continue;
+
+        writers_[i]->send(std::move(command));
+    }
+}
+
+void redis::ShardedWriter::checkpoint(size_t height)
+{
+    for (size_t i{}; i < marker_keys_.size(); ++i)
+    {
+        if (height < next_heights_[i]) continue;
+
+        writers_[i]->send({"SET", marker_keys_[i], std::to_string(height)});
+    }
+}
+
+void redis::ShardedWriter::flush()
+{
+    // flush every shard, even if an earlier one failed
+    std::string errors;
+    for (size_t i{}; i < writers_.size(); ++i)
+    {
+        try
+        {
+            writers_[i]->flush();
+        }
+
+        catch (blockparser::RedisException const& e)
+        {
+            errors += "\nshard " + std::to_string(i) + ": " + e.what();
+        }
+    }
+
+    if (!errors.empty())
+    {
+        throw blockparser::RedisException{"Failed to flush" + errors};
+    }
+}
+
+size_t redis::ShardedWriter::sent() const
+{
+    size_t sent{};
+    for (auto&& writer : writers_)
+    {
+        sent += writer->sent();
+    }
+    return sent;
+}
+
+size_t redis::ShardedWriter::peak_inflight_bytes() const
+{
+    size_t peak{};
+    for (auto&& writer : writers_)
+    {
+        peak += writer->peak_inflight_bytes();
+    }
+    return peak;
+}
@@ -0,0 +1,56 @@
+#include "redis_sink.hpp"
+
+#include <algorithm>
+
+redis::RedisSink::RedisSink(Schema schema, ShardedWriter& writer, size_t checkpoint_blocks)
+    : schema_{std::move(schema)}, writer_{writer}, checkpoint_blocks_{std::max(size_t{1}, checkpoint_blocks)}
+{
+    resume_height_ = writer_.read_progress(schema_.name);
+}
+
+void redis::RedisSink::begin_block(blockparser::Block const& block, uint256 const& hash, size_t height)
+{
+    block_  = &block;
+    hash_   = hash;
+    height_ = height;
+    delta_  = {};
+}
+
+void redis::RedisSink::put_output(blockparser::OutPoint const& outpoint, blockparser::Coin const& coin)
+{
+    delta_.created.emplace_back(outpoint, coin);
+}
+
+void redis::RedisSink::spend(blockparser::OutPoint const& outpoint, blockparser::Coin const& coin)
+{
+    delta_.spent.emplace_back(outpoint, coin);
+}
+
+void redis::RedisSink::end_block(blockparser::UtxoSet const& utxos)
+{
+    writer_.send(schema_.block(*block_, hash_, delta_, utxos), height_);
+    writer_.send({schema_.top(height_)}, height_);
+
+    if ((height_ + 1) % checkpoint_blocks_ == 0)
+    {
+        writer_.checkpoint(height_);
+        unmarked_.reset();
+    }
+    else
+    {
+        unmarked_ = height_;
+    }
+
+    block_ = nullptr;
+}
+
+void redis::RedisSink::flush()
+{
+    if (unmarked_)
+    {
+        writer_.checkpoint(*unmarked_);
+        unmarked_.reset();
+    }
+
+    writer_.flush();
+}
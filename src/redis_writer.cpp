@@ -0,0 +1,272 @@
+#include "redis_writer.hpp"
+
+#include "exception.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <numeric>
+
+namespace
+{
+    // approximate size of a command in the RESP protocol
+    size_t command_bytes(redis::command_t const& command)
+    {
+        return std::accumulate(command.begin(), command.end(), size_t{16},
+                               [](size_t sum, auto const& arg) { return sum + arg.size() + 16; });
+    }
+
+    // names a command in errors: its name and key, if any
+    std::string reply_label(redis::command_t const& command)
+    {
+        std::string label{command.empty() ? "" : command[0]};
+        if (command.size() > 1)
+        {
+            label += " " + command[1];
+        }
+        return label;
+    }
+} // namespace
+
+redis::PipelinedWriter::PipelinedWriter(Options options) : options_{std::move(options)}
+{
+    try
+    {
+        client_.connect(options_.host, options_.port,
+                        [this](std::string const&, std::size_t, cpp_redis::connect_state status)
+                        {
+                            bool was_connected{};
+                            {
+                                std::lock_guard<std::mutex> lock{mutex_};
+                                was_connected = connected_.exchange(status == cpp_redis::connect_state::ok);
+                            }
+                            connected_cv_.notify_all();
+
+                            if (was_connected && status != cpp_redis::connect_state::ok)
+                            {
+                                fail("Connection to " + options_.host + ":" + std::to_string(options_.port) +
+                                     " lost");
+                            }
+                        });
+    }
+
+    catch (std::exception const& e)
+    {
+        throw blockparser::RedisException{"Could not connect to " + options_.host + ":" +
+                                          std::to_string(options_.port) + ": " + e.what()};
+    }
+
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        connected_cv_.wait_for(lock, std::chrono::seconds(1), [this] { return connected_.load(); });
+    }
+
+    if (!connected_.load())
+    {
+        throw blockparser::RedisException{"Could not connect to " + options_.host + ":" +
+                                          std::to_string(options_.port)};
+    }
+
+    io_thread_ = std::thread{&PipelinedWriter::run, this};
+}
+
+redis::PipelinedWriter::~PipelinedWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stopping_ = true;
+    }
+
+    queued_cv_.notify_one();
+    io_thread_.join();
+
+    bool failed{};
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        failed = !failure_.empty();
+    }
+
+    // the reply callbacks take the mutex
+    if (connected_.load() && !failed)
+    {
+        client_.sync_commit();
+    }
+}
+
+void redis::PipelinedWriter::send(command_t command)
+{
+    auto const bytes{command_bytes(command)};
+
+    std::unique_lock<std::mutex> lock{mutex_};
+
+    // backpressure; a single command beyond the cap is let through on its own
+    drained_cv_.wait(lock,
+                     [&]
+                     {
+                         return !failure_.empty() || !inflight_bytes_ ||
+                                inflight_bytes_ + bytes <= options_.max_inflight_bytes;
+                     });
+    throw_if_failed();
+
+    queue_.push_back({std::move(command), bytes});
+    queued_bytes_ += bytes;
+    inflight_bytes_ += bytes;
+    peak_inflight_ = std::max(peak_inflight_, inflight_bytes_);
+
+    if (queue_.size() >= options_.batch_commands || queued_bytes_ >= options_.max_inflight_bytes / 4)
+    {
+        lock.unlock();
+        queued_cv_.notify_one();
+    }
+}
+
+void redis::PipelinedWriter::send(std::vector<command_t> commands)
+{
+    for (auto&& command : commands)
+    {
+        send(std::move(command));
+    }
+}
+
+void redis::PipelinedWriter::flush()
+{
+    std::unique_lock<std::mutex> lock{mutex_};
+
+    flushing_ = true;
+    queued_cv_.notify_one();
+    drained_cv_.wait(lock, [this] { return !failure_.empty() || (queue_.empty() && !unanswered_); });
+    flushing_ = false;
+    throw_if_failed();
+
+    if (errors_)
+    {
+        auto const error{std::to_string(errors_) + " failed commands, first: " + first_error_};
+        errors_ = 0;
+        first_error_.clear();
+        throw blockparser::RedisException{error};
+    }
+}
+
+std::optional<std::string> redis::PipelinedWriter::get(std::string const& key)
+{
+    flush();
+
+    auto future{client_.send({"GET", key})};
+    client_.commit();
+
+    // the reply never comes if the connection drops
+    while (future.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        throw_if_failed();
+    }
+    auto const reply{future.get()};
+
+    if (reply.is_error())
+    {
+        throw blockparser::RedisException{"GET " + key + ": " + reply.as_string()};
+    }
+
+    return reply.is_null() ? std::nullopt : std::make_optional(reply.as_string());
+}
+
+void redis::PipelinedWriter::run()
+{
+    std::unique_lock<std::mutex> lock{mutex_};
+
+    while (true)
+    {
+        queued_cv_.wait(lock,
+                        [this]
+                        {
+                            return stopping_ || !failure_.empty() || queue_.size() >= options_.batch_commands ||
+                                   queued_bytes_ >= options_.max_inflight_bytes / 4 || (flushing_ && !queue_.empty());
+                        });
+
+        // nothing queued can be sent any more; callers are told by throw_if_failed
+        if (!failure_.empty()) break;
+
+        if (queue_.empty())
+        {
+            if (stopping_) break;
+            continue;
+        }
+
+        auto const count{std::min(queue_.size(), options_.batch_commands)};
+        std::vector<Queued> batch{std::make_move_iterator(queue_.begin()),
+                                  std::make_move_iterator(queue_.begin() + count)};
+        queue_.erase(queue_.begin(), queue_.begin() + count);
+
+        for (auto&& queued : batch)
+        {
+            queued_bytes_ -= queued.bytes;
+        }
+
+        unanswered_ += batch.size();
+        sent_ += batch.size();
+        lock.unlock();
+
+        // replies may arrive on the client's thread while the pipeline is still being filled; an exception
+        // must not escape this thread, the callers get it from throw_if_failed
+        try
+        {
+            for (auto&& [command, bytes] : batch)
+            {
+                client_.send(command, [this, key{reply_label(command)}, bytes{bytes}](auto& reply)
+                             { on_reply(reply, key, bytes); });
+            }
+
+            client_.commit();
+        }
+
+        catch (std::exception const& e)
+        {
+            fail("Sending to " + options_.host + ":" + std::to_string(options_.port) + " failed: " + e.what());
+        }
+
+        lock.lock();
+    }
+}
+
+void redis::PipelinedWriter::on_reply(cpp_redis::reply const& reply, std::string const& key, size_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        if (reply.is_error())
+        {
+            if (!errors_++)
+            {
+                first_error_ = key + ": " + reply.as_string();
+            }
+        }
+
+        inflight_bytes_ -= bytes;
+        unanswered_--;
+    }
+
+    drained_cv_.notify_all();
+}
+
+void redis::PipelinedWriter::fail(std::string const& reason)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (failure_.empty())
+        {
+            failure_ = reason;
+        }
+    }
+
+    queued_cv_.notify_one();
+    drained_cv_.notify_all();
+}
+
+void redis::PipelinedWriter::throw_if_failed() const
+{
+    if (!failure_.empty())
+    {
+        throw blockparser::RedisException{failure_ + ", " + std::to_string(unanswered_ + queue_.size()) +
+                                          " commands unanswered"};
+    }
+}
@@ -0,0 +1,141 @@
+#include "rewards.hpp"
+
+#include <algorithm>
+
+void blockparser::RewardSink::begin_block(Block const& block, uint256 const&, size_t height)
+{
+    pending_.clear();
+    claiming_.clear();
+    claimed_ = 0;
+
+    auto const unit{options_.days ? uint64_t{86400} : uint64_t{1}};
+    auto const position{options_.days ? uint64_t{block.header().time_} : uint64_t{height}};
+    bucket_ = position / (unit * std::max(size_t{1}, options_.bucket));
+
+    auto const in_range{height <= options_.to};
+
+    for (auto&& tx : block.transactions())
+    {
+        auto const rewarded{in_range && (is_pos_coinbase(tx) || is_pos_coinbase_ext(tx))};
+
+        for (auto&& vin : tx.vin)
+        {
+            if (claims_output(vin))
+            {
+                claiming_.push_back(rewarded ? pending_.size() : std::string::npos);
+            }
+        }
+
+        if (!rewarded) continue;
+
+        Pending pending;
+        for (auto&& out : tx.vout)
+        {
+            if (is_coinstake(tx, out))
+            {
+                if (pending.staker.empty()) pending.staker = out.address;
+                pending.stake += out.amount;
+            }
+
+            if (is_nodereward(tx, out))
+            {
+                pending.node        = out.address;
+                pending.node_amount = out.amount;
+            }
+        }
+
+        pending_.push_back(std::move(pending));
+    }
+}
+
+void blockparser::RewardSink::spend(OutPoint const&, Coin const& coin)
+{
+    auto const pending{claiming_.at(claimed_++)};
+    if (pending != std::string::npos)
+    {
+        pending_[pending].staked += coin.amount;
+    }
+}
+
+void blockparser::RewardSink::end_block(UtxoSet const&)
+{
+    for (auto&& pending : pending_)
+    {
+        if (!pending.staker.empty())
+        {
+            rewards_.push_back({bucket_, std::move(pending.staker), pending.stake - pending.staked, false});
+        }
+
+        if (!pending.node.empty())
+        {
+            rewards_.push_back({bucket_, std::move(pending.node), pending.node_amount, true});
+        }
+    }
+
+    if (rewards_.size() >= chunk_rewards)
+    {
+        submit();
+    }
+}
+
+blockparser::RewardSink::partial_t blockparser::RewardSink::aggregate(std::vector<Reward> rewards)
+{
+    partial_t partial;
+    for (auto&& reward : rewards)
+    {
+        auto& total{partial[reward.bucket][reward.address]};
+        if (reward.node)
+        {
+            total.node += reward.amount;
+            ++total.nodes;
+        }
+        else
+        {
+            total.stake += reward.amount;
+            ++total.stakes;
+        }
+    }
+
+    return partial;
+}
+
+void blockparser::RewardSink::submit()
+{
+    if (rewards_.empty()) return;
+
+    // bound the chunks held in memory
+    while (aggregating_.size() >= std::max(size_t{1}, options_.threads))
+    {
+        merge_front();
+    }
+
+    aggregating_.push_back(std::async(std::launch::async, &RewardSink::aggregate, std::move(rewards_)));
+    rewards_ = {};
+}
+
+void blockparser::RewardSink::merge_front()
+{
+    auto const partial{aggregating_.front().get()};
+    aggregating_.pop_front();
+
+    for (auto&& [bucket, addresses] : partial)
+    {
+        for (auto&& [address, total] : addresses)
+        {
+            auto& merged{table_[{bucket, address}]};
+            merged.stake += total.stake;
+            merged.stakes += total.stakes;
+            merged.node += total.node;
+            merged.nodes += total.nodes;
+        }
+    }
+}
+
+void blockparser::RewardSink::flush()
+{
+    submit();
+    while (!aggregating_.empty())
+    {
+        merge_front();
+    }
+}
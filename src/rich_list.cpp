@@ -0,0 +1,79 @@
+#include "rich_list.hpp"
+
+#include <algorithm>
+#include <utility>
+
+blockparser::RichListSink::RichListSink(Options options) : options_{std::move(options)}
+{
+    std::sort(options_.heights.begin(), options_.heights.end());
+}
+
+void blockparser::RichListSink::end_block(UtxoSet const& utxos)
+{
+    utxos_ = &utxos;
+    if (std::binary_search(options_.heights.begin(), options_.heights.end(), height_))
+    {
+        take(utxos);
+    }
+}
+
+void blockparser::RichListSink::flush()
+{
+    if (options_.heights.empty() && utxos_)
+    {
+        take(*utxos_);
+    }
+    utxos_ = nullptr;
+}
+
+void blockparser::RichListSink::take(UtxoSet const& utxos)
+{
+    Distribution distribution;
+    distribution.height = height_;
+
+    std::vector<std::pair<std::string const*, int64_t>> holders;
+    std::vector<int64_t> balances;
+    for (auto&& [address, balance] : utxos.balances())
+    {
+        if (balance <= 0) continue;
+
+        holders.emplace_back(&address, balance);
+        balances.push_back(balance);
+        distribution.total += balance;
+    }
+
+    distribution.holders = holders.size();
+
+    // only the top n are ordered
+    auto const richer = [](auto const& lhs, auto const& rhs)
+    {
+        return lhs.second != rhs.second ? lhs.second > rhs.second : *lhs.first < *rhs.first;
+    };
+
+    auto const top{holders.begin() + static_cast<ptrdiff_t>(std::min(options_.top, holders.size()))};
+    std::nth_element(holders.begin(), top, holders.end(), richer);
+    std::sort(holders.begin(), top, richer);
+
+    for (auto it{holders.begin()}; it != top; ++it)
+    {
+        distribution.top.emplace_back(*it->first, it->second);
+        distribution.top_total += it->second;
+    }
+
+    // G = 2 * sum(i * x_i) / (n * sum(x)) - (n + 1) / n, for the x_i ascending from i = 1
+    if (!balances.empty())
+    {
+        std::sort(balances.begin(), balances.end());
+
+        long double weighted{};
+        for (size_t i{}; i < balances.size(); ++i)
+        {
+            weighted += static_cast<long double>(i + 1) * balances[i];
+        }
+
+        long double const n(balances.size());
+        distribution.gini = static_cast<double>(2 * weighted / (n * distribution.total) - (n + 1) / n);
+    }
+
+    distributions_.push_back(std::move(distribution));
+}
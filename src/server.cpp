@@ -0,0 +1,512 @@
+#include "server.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <numeric>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+    uint64_t constexpr listen_id{0};
+    uint64_t constexpr event_id{1};
+
+    std::string quote(std::string const& value)
+    {
+        std::string quoted{"\""};
+        for (auto c : value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                quoted += '\\';
+                quoted += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                quoted += escaped;
+            }
+            else
+            {
+                quoted += c;
+            }
+        }
+        return quoted + "\"";
+    }
+
+    std::string error(std::string const& message) { return "{\"error\":" + quote(message) + "}"; }
+
+    bool is_txid(std::string const& value)
+    {
+        return value.size() == 64 && value.find_first_not_of("0123456789abcdefABCDEF") == std::string::npos;
+    }
+
+    std::string outpoint_json(blockparser::OutPoint const& outpoint, blockparser::Coin const& coin)
+    {
+        return "{\"txid\":\"" + outpoint.hash.ToString() + "\",\"index\":" + std::to_string(outpoint.index) +
+               ",\"address\":" + quote(coin.address) + ",\"amount\":" + std::to_string(coin.amount) +
+               ",\"height\":" + std::to_string(coin.height) + "}";
+    }
+
+    template <typename T, typename F> std::string json_array(T const& values, F const& to_json)
+    {
+        std::string array{"["};
+        for (auto&& value : values)
+        {
+            array += (array.size() > 1 ? "," : "") + to_json(value);
+        }
+        return array + "]";
+    }
+
+    void add_to_epoll(int epoll_fd, int fd, uint64_t id, uint32_t events)
+    {
+        epoll_event event{};
+        event.events   = events;
+        event.data.u64 = id;
+        if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            throw blockparser::ServerException{std::string{"epoll_ctl: "} + std::strerror(errno)};
+        }
+    }
+} // namespace
+
+std::string blockparser::answer(QueryIndex const& index, std::string const& request)
+{
+    std::istringstream ss{request};
+    std::string command;
+    std::string argument;
+    ss >> command >> argument;
+
+    std::string option;
+    ss >> option;
+
+    if (!index.blocks())
+    {
+        return error("no blocks");
+    }
+
+    auto const tip{index.blocks() - 1};
+
+    try
+    {
+        if (command == "balance" && !argument.empty())
+        {
+            auto const height{option.empty() ? tip : std::min<size_t>(std::stoul(option), tip)};
+            auto const balance{index.balance(argument, height)};
+
+            return "{\"address\":" + quote(argument) + ",\"height\":" + std::to_string(height) +
+                   ",\"balance\":" + (balance ? std::to_string(*balance) : "null") + "}";
+        }
+
+        if (command == "utxos" && !argument.empty())
+        {
+            return "{\"address\":" + quote(argument) + ",\"height\":" + std::to_string(tip) + ",\"utxos\":" +
+                   json_array(index.unspent(argument),
+                              [](auto const& entry) { return outpoint_json(entry.first, entry.second); }) +
+                   "}";
+        }
+
+        if (command == "blocks" && !argument.empty())
+        {
+            auto const height{std::stoul(argument)};
+            auto const radius{option.empty() ? 5ul : std::min(std::stoul(option), 100ul)};
+
+            std::vector<size_t> heights;
+            for (auto h{height > radius ? height - radius : 0}; h <= std::min(height + radius, tip); ++h)
+            {
+                heights.push_back(h);
+            }
+
+            return "{\"blocks\":" + json_array(heights,
+                                               [&](size_t h)
+                                               {
+                                                   auto const& block{*index.block(h)};
+                                                   return "{\"height\":" + std::to_string(h) + ",\"hash\":\"" +
+                                                          block.hash.ToString() + "\",\"merkle\":\"" +
+                                                          block.merkle_root.ToString() +
+                                                          "\",\"time\":" + std::to_string(block.time) +
+                                                          ",\"txs\":" +
+                                                          json_array(block.txids,
+                                                                     [](uint256 const& txid)
+                                                                     { return "\"" + txid.ToString() + "\""; }) +
+                                                          "}";
+                                               }) +
+                   "}";
+        }
+
+        if (command == "inputs" && is_txid(argument))
+        {
+            auto const* tx{index.tx(uint256S(argument))};
+            if (!tx) return error("unknown transaction " + argument);
+
+            return "{\"txid\":\"" + argument + "\",\"height\":" + std::to_string(tx->height) + ",\"inputs\":" +
+                   json_array(tx->inputs,
+                              [](auto const& input) { return outpoint_json(input.outpoint, input.coin); }) +
+                   "}";
+        }
+
+        if (command == "spenders" && is_txid(argument))
+        {
+            auto const txid{uint256S(argument)};
+            auto const* tx{index.tx(txid)};
+            if (!tx) return error("unknown transaction " + argument);
+
+            std::vector<uint32_t> outputs(tx->outputs);
+            std::iota(outputs.begin(), outputs.end(), 0);
+
+            return "{\"txid\":\"" + argument + "\",\"outputs\":" +
+                   json_array(outputs,
+                              [&](uint32_t i)
+                              {
+                                  auto const spender{index.spender({txid, i})};
+                                  return "{\"index\":" + std::to_string(i) + ",\"spent_by\":" +
+                                         (spender ? "\"" + spender->txid.ToString() + "\"" : "null") +
+                                         ",\"height\":" + (spender ? std::to_string(spender->height) : "null") +
+                                         "}";
+                              }) +
+                   "}";
+        }
+
+        if (command == "prefix" && !argument.empty())
+        {
+            auto const limit{option.empty() ? 20ul : std::min(std::stoul(option), 1000ul)};
+            auto const& addresses{index.addresses()};
+
+            return "{\"prefix\":" + quote(argument) + ",\"count\":" + std::to_string(addresses.count(argument)) +
+                   ",\"addresses\":" + json_array(addresses.find(argument, limit), quote) + "}";
+        }
+
+        if (command == "spenders" && !argument.empty())
+        {
+            return "{\"address\":" + quote(argument) + ",\"txs\":" +
+                   json_array(index.spending_txs(argument),
+                              [](uint256 const& txid) { return "\"" + txid.ToString() + "\""; }) +
+                   "}";
+        }
+    }
+
+    catch (std::logic_error const&)
+    {
+        return error("invalid number in '" + request + "'");
+    }
+
+    return error("unknown request '" + request + "'");
+}
+
+blockparser::QueryServer::QueryServer(QueryIndex const& index, Options options)
+    : index_{index}, options_{std::move(options)}
+{
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port   = htons(options_.port);
+
+    if (::inet_pton(AF_INET, options_.host.c_str(), &address.sin_addr) != 1)
+    {
+        throw ServerException{"Invalid IPv4 address " + options_.host};
+    }
+
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int const reuse{1};
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    socklen_t length{sizeof(address)};
+    if (listen_fd_ < 0 || ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listen_fd_, SOMAXCONN) != 0 ||
+        ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &length) != 0)
+    {
+        auto const reason{std::strerror(errno)};
+        if (listen_fd_ >= 0) ::close(listen_fd_);
+        throw ServerException{"Can't listen on " + options_.host + ":" + std::to_string(options_.port) + ": " +
+                              reason};
+    }
+
+    port_     = ntohs(address.sin_port);
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    event_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    add_to_epoll(epoll_fd_, listen_fd_, listen_id, EPOLLIN);
+    add_to_epoll(epoll_fd_, event_fd_, event_id, EPOLLIN);
+    next_connection_ = event_id + 1;
+
+    for (size_t i{}; i < std::max(size_t{1}, options_.workers); ++i)
+    {
+        workers_.emplace_back(&QueryServer::work, this);
+    }
+}
+
+blockparser::QueryServer::~QueryServer()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stopping_ = true;
+    }
+
+    jobs_cv_.notify_all();
+    for (auto&& worker : workers_)
+    {
+        worker.join();
+    }
+
+    for (auto&& [id, connection] : connections_)
+    {
+        ::close(connection.fd);
+    }
+
+    ::close(event_fd_);
+    ::close(epoll_fd_);
+    ::close(listen_fd_);
+}
+
+void blockparser::QueryServer::stop()
+{
+    stop_.store(true);
+
+    uint64_t const one{1};
+    [[maybe_unused]] auto const written{::write(event_fd_, &one, sizeof(one))};
+}
+
+void blockparser::QueryServer::run()
+{
+    std::vector<epoll_event> events(64);
+
+    while (!stop_.load())
+    {
+        auto const count{::epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), -1)};
+        if (count < 0)
+        {
+            if (errno == EINTR) continue;
+            throw ServerException{std::string{"epoll_wait: "} + std::strerror(errno)};
+        }
+
+        for (int i{}; i < count; ++i)
+        {
+            auto const id{events[i].data.u64};
+
+            if (id == listen_id)
+            {
+                accept_connections();
+                continue;
+            }
+
+            if (id == event_id)
+            {
+                uint64_t value{};
+                [[maybe_unused]] auto const read{::read(event_fd_, &value, sizeof(value))};
+                deliver_answers();
+                continue;
+            }
+
+            // may have been closed by an earlier event of this round
+            auto it{connections_.find(id)};
+            if (it == connections_.end()) continue;
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+            {
+                close(id);
+                continue;
+            }
+
+            if (events[i].events & EPOLLIN)
+            {
+                read(id, it->second);
+            }
+
+            it = connections_.find(id);
+            if (it != connections_.end() && events[i].events & EPOLLOUT)
+            {
+                write(id, it->second);
+            }
+        }
+    }
+}
+
+void blockparser::QueryServer::accept_connections()
+{
+    while (true)
+    {
+        auto const fd{::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)};
+        if (fd < 0) return; // EAGAIN, or the peer is gone already
+
+        auto const id{next_connection_++};
+        auto& connection{connections_[id]};
+        connection.fd     = fd;
+        connection.events = EPOLLIN;
+        add_to_epoll(epoll_fd_, fd, id, connection.events);
+    }
+}
+
+void blockparser::QueryServer::read(uint64_t id, Connection& connection)
+{
+    // up to the end of a request: the rest is left to the socket until the connection answered it
+    char buffer[4096];
+    while (connection.in.find('\n') == std::string::npos && connection.in.size() <= max_request_bytes)
+    {
+        auto const received{::recv(connection.fd, buffer, sizeof(buffer), 0)};
+        if (received > 0)
+        {
+            connection.in.append(buffer, static_cast<size_t>(received));
+            continue;
+        }
+
+        if (received == 0)
+        {
+            connection.closing = true;
+        }
+        else if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            close(id);
+            return;
+        }
+        break;
+    }
+
+    if (connection.in.find('\n') == std::string::npos && connection.in.size() > max_request_bytes)
+    {
+        close(id);
+        return;
+    }
+
+    dispatch(id, connection);
+}
+
+void blockparser::QueryServer::dispatch(uint64_t id, Connection& connection)
+{
+    auto const end{connection.in.find('\n')};
+
+    if (connection.busy || end == std::string::npos)
+    {
+        // nothing left to answer for a peer that closed its side
+        if (connection.closing && !connection.busy && connection.out.empty())
+        {
+            close(id);
+            return;
+        }
+
+        watch(id, connection);
+        return;
+    }
+
+    auto request{connection.in.substr(0, end)};
+    connection.in.erase(0, end + 1);
+    if (!request.empty() && request.back() == '\r')
+    {
+        request.pop_back();
+    }
+
+    connection.busy = true;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        jobs_.push_back({id, std::move(request)});
+    }
+    jobs_cv_.notify_one();
+
+    watch(id, connection);
+}
+
+void blockparser::QueryServer::write(uint64_t id, Connection& connection)
+{
+    while (!connection.out.empty())
+    {
+        auto const sent{::send(connection.fd, connection.out.data(), connection.out.size(), MSG_NOSIGNAL)};
+        if (sent < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+
+            close(id);
+            return;
+        }
+
+        connection.out.erase(0, static_cast<size_t>(sent));
+    }
+
+    if (connection.out.empty())
+    {
+        dispatch(id, connection);
+    }
+    else
+    {
+        watch(id, connection);
+    }
+}
+
+void blockparser::QueryServer::watch(uint64_t id, Connection& connection)
+{
+    // read only while there is nothing to answer, which bounds both buffers, and never after the peer closed
+    // its side (that would be reported again and again); wait for writability only while output is pending
+    auto const idle{!connection.closing && !connection.busy && connection.out.empty() &&
+                    connection.in.find('\n') == std::string::npos};
+    uint32_t const events{(idle ? EPOLLIN : 0u) | (connection.out.empty() ? 0u : EPOLLOUT)};
+
+    if (events != connection.events)
+    {
+        connection.events = events;
+
+        epoll_event event{};
+        event.events   = events;
+        event.data.u64 = id;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event);
+    }
+}
+
+void blockparser::QueryServer::deliver_answers()
+{
+    std::vector<Job> answers;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        answers.swap(answers_);
+    }
+
+    for (auto&& [id, answer] : answers)
+    {
+        auto const it{connections_.find(id)};
+        if (it == connections_.end()) continue;
+
+        it->second.busy = false;
+        it->second.out += answer + "\n";
+        write(id, it->second);
+    }
+}
+
+void blockparser::QueryServer::close(uint64_t id)
+{
+    auto const it{connections_.find(id)};
+    if (it == connections_.end()) return;
+
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    ::close(it->second.fd);
+    connections_.erase(it);
+}
+
+void blockparser::QueryServer::work()
+{
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock{mutex_};
+            jobs_cv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+            if (stopping_) return;
+
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        job.request = answer(index_, job.request);
+
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            answers_.push_back(std::move(job));
+        }
+
+        uint64_t const one{1};
+        [[maybe_unused]] auto const written{::write(event_fd_, &one, sizeof(one))};
+    }
+}
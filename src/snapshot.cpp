@@ -0,0 +1,236 @@
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zenon/crypto/sha256.h>
+
+using namespace blockparser::snapshot;
+
+namespace
+{
+    void copy_address(char (&field)[address_size], std::string const& address)
+    {
+        if (address.size() > address_size)
+        {
+            throw blockparser::SnapshotException{"Address too long: " + address};
+        }
+
+        std::memset(field, 0, address_size);
+        std::memcpy(field, address.data(), address.size());
+    }
+
+    template <typename T> void write_records(std::ofstream& file, CSHA256& hasher, std::vector<T> const& records)
+    {
+        auto const bytes{reinterpret_cast<unsigned char const*>(records.data())};
+        hasher.Write(bytes, records.size() * sizeof(T));
+        file.write(reinterpret_cast<char const*>(bytes), records.size() * sizeof(T));
+    }
+} // namespace
+
+void blockparser::write_snapshot(std::string const& path, UtxoSet const& utxos)
+{
+    if (utxos.empty())
+    {
+        throw SnapshotException{"Refusing to write a snapshot without tip"};
+    }
+
+    std::vector<SnapshotCoin> coins(utxos.coins().size());
+    std::transform(utxos.coins().begin(), utxos.coins().end(), coins.begin(),
+                   [](auto const& entry)
+                   {
+                       SnapshotCoin coin{};
+                       std::memcpy(coin.hash, entry.first.hash.begin(), sizeof(coin.hash));
+                       coin.index  = entry.first.index;
+                       coin.height = entry.second.height;
+                       coin.amount = entry.second.amount;
+                       copy_address(coin.address, entry.second.address);
+                       return coin;
+                   });
+    std::sort(coins.begin(), coins.end());
+
+    std::vector<SnapshotBalance> balances(utxos.balances().size());
+    std::transform(utxos.balances().begin(), utxos.balances().end(), balances.begin(),
+                   [](auto const& entry)
+                   {
+                       SnapshotBalance balance{};
+                       copy_address(balance.address, entry.first);
+                       balance.balance = entry.second;
+                       return balance;
+                   });
+    std::sort(balances.begin(), balances.end());
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version       = version;
+    header.height        = utxos.next_height() - 1;
+    header.coin_count    = coins.size();
+    header.balance_count = balances.size();
+    header.zerocoin_pool = utxos.zerocoin_pool();
+    std::memcpy(header.tip, utxos.tip().begin(), sizeof(header.tip));
+
+    auto const tmp_path{path + ".tmp"};
+    std::ofstream file{tmp_path, std::ios::binary | std::ios::trunc};
+    if (!file)
+    {
+        throw SnapshotException{"Can't open " + tmp_path + " for writing"};
+    }
+
+    // reserve the header; it is rewritten once the checksum is known
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+    // the header is hashed with the checksum still zeroed
+    CSHA256 hasher;
+    hasher.Write(reinterpret_cast<unsigned char const*>(&header), sizeof(header));
+    write_records(file, hasher, coins);
+    write_records(file, hasher, balances);
+    hasher.Finalize(header.checksum);
+
+    file.seekp(0);
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    file.close();
+
+    if (!file || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        throw SnapshotException{"Failed to write " + path};
+    }
+}
+
+blockparser::MappedSnapshot::MappedSnapshot(std::string const& path)
+{
+    auto const fd{::open(path.c_str(), O_RDONLY)};
+    if (fd < 0)
+    {
+        throw SnapshotException{"Can't open " + path};
+    }
+
+    struct stat st
+    {
+    };
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader))
+    {
+        ::close(fd);
+        throw SnapshotException{path + " is too small to be a snapshot"};
+    }
+
+    size_ = st.st_size;
+    data_ = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (data_ == MAP_FAILED)
+    {
+        data_ = nullptr;
+        throw SnapshotException{"Can't map " + path};
+    }
+
+    auto const bytes{static_cast<uint8_t const*>(data_)};
+    header_   = reinterpret_cast<SnapshotHeader const*>(bytes);
+    coins_    = reinterpret_cast<SnapshotCoin const*>(bytes + sizeof(SnapshotHeader));
+    balances_ = reinterpret_cast<SnapshotBalance const*>(coins_ + header_->coin_count);
+
+    auto const fail = [&](std::string const& reason)
+    {
+        ::munmap(data_, size_);
+        data_ = nullptr;
+        throw SnapshotException{path + ": " + reason};
+    };
+
+    if (std::memcmp(header_->magic, magic, sizeof(magic)))
+    {
+        fail("not a snapshot file");
+    }
+
+    if (header_->version != version)
+    {
+        fail("unsupported version " + std::to_string(header_->version));
+    }
+
+    auto const expected_size{sizeof(SnapshotHeader) + header_->coin_count * sizeof(SnapshotCoin) +
+                             header_->balance_count * sizeof(SnapshotBalance)};
+    if (expected_size != size_)
+    {
+        fail("size " + std::to_string(size_) + " does not match expected " + std::to_string(expected_size));
+    }
+
+    auto header{*header_};
+    std::memset(header.checksum, 0, sizeof(header.checksum));
+
+    uint8_t checksum[CSHA256::OUTPUT_SIZE];
+    CSHA256{}
+        .Write(reinterpret_cast<unsigned char const*>(&header), sizeof(header))
+        .Write(bytes + sizeof(SnapshotHeader), size_ - sizeof(SnapshotHeader))
+        .Finalize(checksum);
+    if (std::memcmp(checksum, header_->checksum, sizeof(checksum)))
+    {
+        fail("checksum mismatch");
+    }
+
+    ::madvise(data_, size_, MADV_SEQUENTIAL);
+}
+
+blockparser::MappedSnapshot::~MappedSnapshot()
+{
+    if (data_)
+    {
+        ::munmap(data_, size_);
+    }
+}
+
+uint256 blockparser::MappedSnapshot::tip() const
+{
+    uint256 tip;
+    std::memcpy(tip.begin(), header_->tip, sizeof(header_->tip));
+    return tip;
+}
+
+SnapshotCoin const* blockparser::MappedSnapshot::find(OutPoint const& outpoint) const
+{
+    SnapshotCoin key{};
+    std::memcpy(key.hash, outpoint.hash.begin(), sizeof(key.hash));
+    key.index = outpoint.index;
+
+    auto const end{coins_ + coin_count()};
+    auto const it{std::lower_bound(coins_, end, key)};
+
+    return it != end && !(key < *it) ? it : nullptr;
+}
+
+std::optional<int64_t> blockparser::MappedSnapshot::balance(std::string const& address) const
+{
+    SnapshotBalance key{};
+    copy_address(key.address, address);
+
+    auto const end{balances_ + balance_count()};
+    auto const it{std::lower_bound(balances_, end, key)};
+
+    if (it == end || key < *it) return std::nullopt;
+    return it->balance;
+}
+
+blockparser::UtxoSet blockparser::MappedSnapshot::to_utxo_set() const
+{
+    UtxoSet utxos;
+
+    for (size_t i{}; i < coin_count(); ++i)
+    {
+        auto const& coin{coins_[i]};
+
+        OutPoint outpoint{uint256{}, coin.index};
+        std::memcpy(outpoint.hash.begin(), coin.hash, sizeof(coin.hash));
+
+        utxos.restore(std::move(outpoint), Coin{coin.amount, coin.height, snapshot::address(coin.address)});
+    }
+
+    for (size_t i{}; i < balance_count(); ++i)
+    {
+        utxos.restore_balance(snapshot::address(balances_[i].address), balances_[i].balance);
+    }
+
+    utxos.restore_zerocoin_pool(zerocoin_pool());
+    utxos.restore_tip(tip(), height());
+    return utxos;
+}
@@ -0,0 +1,198 @@
+#include "supply.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <libzerocoin/Denominations.h>
+
+namespace
+{
+    char const* phase_name(uint8_t phase)
+    {
+        switch (phase)
+        {
+        case blockparser::supply::pow: return "pow";
+        case blockparser::supply::pos: return "pos";
+        case blockparser::supply::pos_ext: return "pos_ext";
+        }
+        return "unknown";
+    }
+} // namespace
+
+blockparser::SupplySink::SupplySink(std::string const& path, Format format)
+    : path_{path}, format_{format}, file_{path, std::ios::binary | std::ios::trunc}
+{
+    if (!file_)
+    {
+        throw SupplyException{"Can't create " + path};
+    }
+
+    if (format_ == Format::binary)
+    {
+        supply::SupplyHeader header{};
+        std::memcpy(header.magic, supply::magic, sizeof(header.magic));
+        header.version     = supply::version;
+        header.record_size = sizeof(supply::SupplyRecord);
+        file_.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    }
+    else
+    {
+        file_ << "height,phase,minted,fees,supply,zerocoin,utxos\n";
+    }
+}
+
+void blockparser::SupplySink::begin_block(Block const& block, uint256 const&, size_t height)
+{
+    pending_.clear();
+    claiming_.clear();
+    claimed_ = 0;
+    height_  = height;
+
+    for (auto&& tx : block.transactions())
+    {
+        Pending pending;
+        for (auto&& vout : tx.vout)
+        {
+            pending.out += vout.amount;
+        }
+
+        for (auto&& vin : tx.vin)
+        {
+            if (claims_output(vin))
+            {
+                claiming_.push_back(pending_.size());
+            }
+            else if (is_zerocoin_spend(vin))
+            {
+                pending.in += zerocoin_spend_amount(vin);
+            }
+        }
+
+        // empty pow coinbases continue after the switch to pos
+        if (is_pos_coinbase(tx))
+        {
+            phase_ = std::max<uint8_t>(phase_, supply::pos);
+        }
+        else if (is_pos_coinbase_ext(tx))
+        {
+            phase_ = supply::pos_ext;
+        }
+
+        // a coinbase claims nothing; an extended pos coinbase claims the stake
+        pending.minting = is_pos_coinbase_ext(tx) ||
+                          std::all_of(tx.vin.begin(), tx.vin.end(),
+                                      [](auto const& vin) { return is_coinbase_input(vin); });
+
+        pending_.push_back(pending);
+    }
+}
+
+void blockparser::SupplySink::spend(OutPoint const&, Coin const& coin)
+{
+    pending_.at(claiming_.at(claimed_++)).in += coin.amount;
+}
+
+void blockparser::SupplySink::end_block(UtxoSet const& utxos)
+{
+    supply::SupplyRecord record{};
+    record.phase    = phase_;
+    record.zerocoin = utxos.zerocoin_pool();
+    record.utxos = static_cast<uint32_t>(utxos.coins().size());
+
+    for (auto&& pending : pending_)
+    {
+        if (pending.minting)
+        {
+            record.minted += pending.out - pending.in;
+        }
+        else
+        {
+            record.fees += pending.in - pending.out;
+            anomalies_ += pending.in < pending.out;
+        }
+    }
+
+    supply_ += record.minted - record.fees;
+    record.supply = supply_;
+
+    if (format_ == Format::binary)
+    {
+        file_.write(reinterpret_cast<char const*>(&record), sizeof(record));
+    }
+    else
+    {
+        file_ << height_ << ',' << phase_name(record.phase) << ',' << record.minted << ',' << record.fees << ','
+              << record.supply << ',' << record.zerocoin << ',' << record.utxos << '\n';
+    }
+}
+
+void blockparser::SupplySink::flush()
+{
+    file_.flush();
+    if (!file_)
+    {
+        throw SupplyException{"Failed to write " + path_};
+    }
+}
+
+blockparser::ZerocoinSink::ZerocoinSink(std::string const& path) : path_{path}, file_{path, std::ios::trunc}
+{
+    if (!file_)
+    {
+        throw SupplyException{"Can't create " + path};
+    }
+
+    file_ << "height,denomination,mints,spends,minted,spent,pool\n";
+}
+
+void blockparser::ZerocoinSink::begin_block(Block const& block, uint256 const&, size_t height)
+{
+    block_.clear();
+    height_ = height;
+
+    for (auto&& tx : block.transactions())
+    {
+        for (auto&& vin : tx.vin)
+        {
+            if (is_zerocoin_spend(vin))
+            {
+                auto& total{block_[libzerocoin::IntToZerocoinDenomination(vin.sequence)]};
+                ++total.spends;
+                total.spent += zerocoin_spend_amount(vin);
+            }
+        }
+
+        for (auto&& vout : tx.vout)
+        {
+            if (vout.type == script_t::ZEROCOINMINT)
+            {
+                auto& total{block_[libzerocoin::AmountToZerocoinDenomination(vout.amount)]};
+                ++total.mints;
+                total.minted += vout.amount;
+            }
+        }
+    }
+}
+
+void blockparser::ZerocoinSink::end_block(UtxoSet const& utxos)
+{
+    for (auto&& [denomination, total] : block_)
+    {
+        file_ << height_ << ',' << denomination << ',' << total.mints << ',' << total.spends << ',' << total.minted
+              << ',' << total.spent << ',' << utxos.zerocoin_pool() << '\n';
+
+        auto& sum{totals_[denomination]};
+        sum.mints += total.mints;
+        sum.spends += total.spends;
+        sum.minted += total.minted;
+        sum.spent += total.spent;
+    }
+}
+
+void blockparser::ZerocoinSink::flush()
+{
+    file_.flush();
+    if (!file_)
+    {
+        throw SupplyException{"Failed to write " + path_};
+    }
+}
@@ -12,15 +12,11 @@ void check_for_coinbase(blockparser::TxInput const& input)
     assert(input.index == 0xffffffff); // no previous outpoint
 }
 
-/// Validates that the interpretation of transaction types is correct
-auto assert_schema_matches_assumption(blockparser::Transaction const& tx)
+void blockparser::assert_schema_matches_assumption(Transaction const& tx, SchemaPhase& state)
 {
-    static int current_phase = 0; // pow
-    static bool seen_regular_tx{};
-
     if (blockparser::is_pow_coinbase(tx))
     {
-        if (current_phase != 0)
+        if (state.phase != 0)
         {
             if (!blockparser::is_empty_pow(tx))
             {
@@ -32,13 +28,13 @@ auto assert_schema_matches_assumption(blockparser::Transaction const& tx)
     }
     else if (blockparser::is_pos_coinbase(tx))
     {
-        if (current_phase == 0)
+        if (state.phase == 0)
         {
             std::cout << "Switching to POS: " << std::endl;
             std::cout << tx << std::endl;
-            current_phase = 1;
+            state.phase = 1;
         }
-        else if (current_phase != 1)
+        else if (state.phase != 1)
         {
             std::cout << "Unexpected POS:" << std::endl;
             std::cout << tx << std::endl;
@@ -47,24 +43,24 @@ auto assert_schema_matches_assumption(blockparser::Transaction const& tx)
     }
     else if (blockparser::is_pos_coinbase_ext(tx))
     {
-        if (current_phase == 1)
+        if (state.phase == 1)
         {
             std::cout << "Switching to POS_EXT: " << std::endl;
             std::cout << tx << std::endl;
-            current_phase = 2;
+            state.phase = 2;
         }
-        else if (current_phase != 2)
+        else if (state.phase != 2)
         {
             std::cout << "Unexpected POS_EXT:" << std::endl;
             std::cout << tx << std::endl;
             assert(false);
         }
     }
-    else if (!seen_regular_tx)
+    else if (!state.seen_regular_tx)
     {
         std::cout << "First regular TX:" << std::endl;
         std::cout << tx << std::endl;
-        seen_regular_tx = true;
+        state.seen_regular_tx = true;
     }
 }
 
@@ -147,7 +143,5 @@ blockparser::Transaction blockparser::read_transaction(std::ifstream& stream)
     hasher.Finalize(reinterpret_cast<unsigned char*>(&tx.hash));
     // std::cout << "Hash " << tx.hash << std::endl;
 
-    assert_schema_matches_assumption(tx);
-
     return tx;
 }
@@ -3,6 +3,8 @@
 #include "util.hpp"
 #include "znn_constants.hpp"
 
+#include <libzerocoin/Denominations.h>
+
 blockparser::TxInput blockparser::read_tx_input(std::ifstream& stream)
 {
     // Serialized TX Inputs consist of (in that order):
@@ -28,3 +30,8 @@ blockparser::TxInput blockparser::read_tx_input(std::ifstream& stream)
 
     return input;
 }
+
+int64_t blockparser::zerocoin_spend_amount(TxInput const& vin)
+{
+    return libzerocoin::ZerocoinDenominationToAmount(libzerocoin::IntToZerocoinDenomination(vin.sequence));
+}
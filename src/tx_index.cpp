@@ -0,0 +1,147 @@
+#include "tx_index.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <zenon/crypto/sha256.h>
+
+namespace
+{
+    // File layout: TxIndexHeader, TxLocation[count] sorted by prefix. The checksum covers the header (with
+    // the checksum zeroed) and the locations.
+    char constexpr txindex_magic[8]{'Z', 'N', 'N', 'T', 'X', 'I', 'X', '\0'};
+    uint32_t constexpr txindex_version{2};
+
+    struct TxIndexHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t height;
+        uint8_t tip[32];
+        uint64_t count;
+        uint8_t checksum[32];
+    };
+
+    static_assert(sizeof(TxIndexHeader) == 96);
+
+    bool by_prefix(blockparser::TxLocation const& lhs, blockparser::TxLocation const& rhs)
+    {
+        return lhs.prefix < rhs.prefix;
+    }
+} // namespace
+
+void blockparser::TxIndex::add(Block const& block, ChainEntry const& entry, size_t height)
+{
+    if (height != next_height_)
+    {
+        throw ParseException{"TxIndex: expected block " + std::to_string(next_height_) + ", got " +
+                             std::to_string(height)};
+    }
+
+    for (auto&& tx : block.transactions())
+    {
+        locations_.push_back({txid_prefix(tx.hash), entry.location.file,
+                              static_cast<uint32_t>(entry.location.offset), tx.offset, tx.size});
+    }
+
+    sorted_      = false;
+    tip_         = entry.hash;
+    next_height_ = height + 1;
+}
+
+void blockparser::TxIndex::sort()
+{
+    if (!sorted_)
+    {
+        std::stable_sort(locations_.begin(), locations_.end(), by_prefix);
+        sorted_ = true;
+    }
+}
+
+std::vector<blockparser::TxLocation> blockparser::TxIndex::find(uint256 const& txid)
+{
+    sort();
+
+    auto const [first, last]{
+        std::equal_range(locations_.begin(), locations_.end(), TxLocation{txid_prefix(txid)}, by_prefix)};
+    return {first, last};
+}
+
+void blockparser::TxIndex::save(std::string const& path)
+{
+    sort();
+
+    TxIndexHeader header{};
+    std::memcpy(header.magic, txindex_magic, sizeof(txindex_magic));
+    header.version = txindex_version;
+    header.height  = next_height_ - 1;
+    header.count   = locations_.size();
+    std::memcpy(header.tip, tip_.begin(), sizeof(header.tip));
+
+    auto const bytes{reinterpret_cast<unsigned char const*>(locations_.data())};
+    auto const size{locations_.size() * sizeof(TxLocation)};
+    CSHA256{}
+        .Write(reinterpret_cast<unsigned char const*>(&header), sizeof(header))
+        .Write(bytes, size)
+        .Finalize(header.checksum);
+
+    auto const tmp_path{path + ".tmp"};
+    std::ofstream file{tmp_path, std::ios::binary | std::ios::trunc};
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    file.write(reinterpret_cast<char const*>(bytes), size);
+    file.close();
+
+    if (!file || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        std::cout << "Failed to write the tx index to " << path << std::endl;
+    }
+}
+
+bool blockparser::TxIndex::load(std::string const& path)
+{
+    std::ifstream file{path, std::ios::binary | std::ios::ate};
+    if (!file)
+    {
+        return false;
+    }
+
+    auto const size{static_cast<size_t>(file.tellg())};
+    file.seekg(0);
+
+    TxIndexHeader header{};
+    if (size < sizeof(header) || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, txindex_magic, sizeof(txindex_magic)) || header.version != txindex_version ||
+        size != sizeof(header) + header.count * sizeof(TxLocation))
+    {
+        std::cout << "Ignoring invalid tx index " << path << std::endl;
+        return false;
+    }
+
+    std::vector<TxLocation> locations(header.count);
+    file.read(reinterpret_cast<char*>(locations.data()), locations.size() * sizeof(TxLocation));
+
+    auto unchecked{header};
+    std::memset(unchecked.checksum, 0, sizeof(unchecked.checksum));
+
+    uint8_t checksum[CSHA256::OUTPUT_SIZE];
+    CSHA256{}
+        .Write(reinterpret_cast<unsigned char const*>(&unchecked), sizeof(unchecked))
+        .Write(reinterpret_cast<unsigned char const*>(locations.data()), locations.size() * sizeof(TxLocation))
+        .Finalize(checksum);
+
+    if (!file || std::memcmp(checksum, header.checksum, sizeof(checksum)))
+    {
+        std::cout << "Ignoring corrupt tx index " << path << std::endl;
+        return false;
+    }
+
+    locations_ = std::move(locations);
+    sorted_    = true;
+    std::memcpy(tip_.begin(), header.tip, sizeof(header.tip));
+    next_height_ = header.height + 1;
+
+    return true;
+}
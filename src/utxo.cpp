@@ -0,0 +1,74 @@
+#include "utxo.hpp"
+
+#include <util.hpp>
+
+blockparser::BlockDelta blockparser::UtxoSet::apply(Block const& block, uint256 const& hash, size_t height)
+{
+    if (height != next_height_ || (!empty() && block.header().hash_previous_block_ != tip_))
+    {
+        throw UtxoException{"Block " + hash.ToString() + " at height " + std::to_string(height) +
+                            " does not extend tip " + tip_.ToString()};
+    }
+
+    BlockDelta delta;
+
+    for (auto&& tx : block.transactions())
+    {
+        for (auto&& vin : tx.vin)
+        {
+            if (is_zerocoin_spend(vin))
+            {
+                zerocoin_pool_ -= zerocoin_spend_amount(vin);
+                continue;
+            }
+
+            if (!claims_output(vin)) continue;
+
+            auto it{coins_.find(OutPoint{vin.tx_hash, vin.index})};
+            if (it == coins_.end())
+            {
+                throw UtxoException{"In block " + std::to_string(height) + ", TX=" + tx.hash.ToString() +
+                                    ": unknown output " + vin.tx_hash.ToString() + ", n=" + std::to_string(vin.index)};
+            }
+
+            if (!it->second.address.empty())
+            {
+                balances_[it->second.address] -= it->second.amount;
+            }
+
+            delta.spent.emplace_back(it->first, std::move(it->second));
+            coins_.erase(it);
+        }
+
+        for (size_t i{}; i < tx.vout.size(); ++i)
+        {
+            auto const& vout{tx.vout[i]};
+
+            // zerocoin mints are claimed by zerocoin spends, from the pool
+            if (vout.type == script_t::ZEROCOINMINT)
+            {
+                zerocoin_pool_ += vout.amount;
+                continue;
+            }
+
+            // empty coinstake markers and zero-value nonstandard outputs can't be claimed
+            if (vout.address.empty() && !vout.amount) continue;
+
+            OutPoint outpoint{tx.hash, static_cast<uint32_t>(i)};
+            Coin coin{vout.amount, static_cast<uint32_t>(height), vout.address};
+
+            if (!coin.address.empty())
+            {
+                balances_[coin.address] += coin.amount;
+            }
+
+            coins_[outpoint] = coin;
+            delta.created.emplace_back(std::move(outpoint), std::move(coin));
+        }
+    }
+
+    tip_         = hash;
+    next_height_ = height + 1;
+
+    return delta;
+}
@@ -0,0 +1,109 @@
+#include "utxo_histogram.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+    size_t band(int64_t amount)
+    {
+        size_t digits{};
+        for (; amount > 0; amount /= 10)
+        {
+            ++digits;
+        }
+        return digits;
+    }
+} // namespace
+
+blockparser::UtxoHistogramSink::UtxoHistogramSink(std::string const& path, Options options)
+    : path_{path}, options_{std::move(options)}, file_{path, std::ios::trunc}
+{
+    if (!file_)
+    {
+        throw HistogramException{"Can't create " + path};
+    }
+
+    std::sort(options_.heights.begin(), options_.heights.end());
+    file_ << "height,histogram,lower,upper,outputs,amount\n";
+}
+
+void blockparser::UtxoHistogramSink::put_output(OutPoint const&, Coin const& coin)
+{
+    outputs_.add(coin.height, 1);
+    amounts_.add(coin.height, coin.amount);
+
+    auto& b{bands_[band(coin.amount)]};
+    ++b.outputs;
+    b.amount += coin.amount;
+}
+
+void blockparser::UtxoHistogramSink::spend(OutPoint const&, Coin const& coin)
+{
+    outputs_.add(coin.height, -1);
+    amounts_.add(coin.height, -coin.amount);
+
+    auto& b{bands_[band(coin.amount)]};
+    --b.outputs;
+    b.amount -= coin.amount;
+}
+
+void blockparser::UtxoHistogramSink::end_block(UtxoSet const&)
+{
+    fed_ = true;
+
+    if (std::binary_search(options_.heights.begin(), options_.heights.end(), height_) ||
+        (options_.every && height_ % options_.every == 0))
+    {
+        write(height_);
+    }
+}
+
+void blockparser::UtxoHistogramSink::flush()
+{
+    if (fed_ && options_.heights.empty() && !options_.every)
+    {
+        write(height_);
+    }
+
+    file_.flush();
+    if (!file_)
+    {
+        throw HistogramException{"Failed to write " + path_};
+    }
+}
+
+void blockparser::UtxoHistogramSink::write(size_t height)
+{
+    // an output of age a was created at height - a, so the ages [lower, upper) are the creation heights
+    // (height - upper, height - lower]
+    for (size_t lower{}, upper{1}; lower <= height; lower = upper, upper *= 2)
+    {
+        auto const begin{height + 1 - std::min(upper, height + 1)};
+        auto const end{height + 1 - lower};
+
+        file_ << height << ",age," << lower << ',' << upper << ',' << outputs_.range(begin, end) << ','
+              << amounts_.range(begin, end) << '\n';
+    }
+
+    // band i > 0 holds the amounts of i digits, the last one has no upper bound in int64
+    for (size_t i{}; i < bands_.size(); ++i)
+    {
+        if (!bands_[i].outputs) continue;
+
+        int64_t lower{i > 0 ? 1 : 0};
+        for (size_t digit{1}; digit < i; ++digit)
+        {
+            lower *= 10;
+        }
+
+        file_ << height << ",amount," << lower << ',';
+        if (i + 1 < bands_.size())
+        {
+            file_ << (i == 0 ? 1 : lower * 10);
+        }
+        file_ << ',' << bands_[i].outputs << ',' << bands_[i].amount << '\n';
+    }
+
+    ++written_;
+}